@@ -8,27 +8,90 @@ GP22::GP22(int slaveSelectPin) {
 }
 
 GP22::~GP22() {
-  SPI.end();
+  // A shared controller is shut down by whoever owns the bus (GP22Bus::end())
+  if (!_bus)
+    _transport->end();
 }
 
 void GP22::begin() {
-  //Start up SPI
-  SPI.begin(_ssPin);
-  //Run the SPI clock at 14 MHz (GP22's max is apparently 20 MHz)
-  SPI.setClockDivider(_ssPin, 6);
-  //Clock polarity = 0, clock phase = 1 (MODE1?)
-  SPI.setDataMode(_ssPin, SPI_MODE1);
-  //The GP22 sends the most significant bit first
-  SPI.setBitOrder(_ssPin, MSBFIRST);
+  //Start up SPI. On a shared bus the settings get applied when we take it over.
+  if (_bus)
+    busAcquire(NORMAL_PRIORITY);
+  else
+    setupSPI();
   //Power-on-reset command
-  SPI.transfer(_ssPin, 0x50);
+  transferOpcode(0x50, NORMAL_PRIORITY);
+  busRelease();
   //Transfer the GP22 config registers across
   updateConfig();
 }
 
+bool GP22::resume(const GP22State &state) {
+  setConfig(state.config);
+  // setConfig() worked these out again, but they are the same as the saved ones
+  _conversionFactorRead = state.conversionFactorRead;
+  _conversionFactorDelay = state.conversionFactorDelay;
+  _configGeneration = state.configGeneration;
+
+  if (_bus)
+    busAcquire(NORMAL_PRIORITY);
+  else
+    setupSPI();
+  bool same = testComms();
+  busRelease();
+
+  if (!same)
+    begin();
+  return same;
+}
+
+void GP22::saveState(GP22State &state) {
+  getConfig(state.config);
+  state.configGeneration = _configGeneration;
+  state.conversionFactorRead = _conversionFactorRead;
+  state.conversionFactorDelay = _conversionFactorDelay;
+}
+
+void GP22::setupSPI() {
+  //14 MHz, mode 1, MSB first (see the transport for the details)
+  _transport->begin(_ssPin);
+}
+
 //Initilise measurement
 void GP22::measure() {
-  SPI.transfer(_ssPin, 0x70);
+  transferOpcode(0x70, TDC_PRIORITY);
+}
+
+//Start_Temp, measure the temperature sensor ports
+void GP22::measureTemperature() {
+  transferOpcode(0x02, TDC_PRIORITY);
+}
+
+void GP22::setBus(GP22Bus * bus) {
+  _bus = bus;
+  // Use whichever SPI controller the bus is on
+  _transport = bus ? bus->getTransport() : &gp22DefaultTransport();
+}
+GP22Bus * GP22::getBus() {
+  return _bus;
+}
+void GP22::lockBus(BusPriority priority) {
+  busAcquire(priority);
+}
+void GP22::unlockBus() {
+  busRelease();
+}
+
+void GP22::busAcquire(BusPriority priority) {
+  if (_bus)
+    _bus->acquire(this, priority, applyBusSettings);
+}
+void GP22::busRelease() {
+  if (_bus)
+    _bus->release();
+}
+void GP22::applyBusSettings(void * gp22) {
+  ((GP22 *)gp22)->setupSPI();
 }
 
 void GP22::readStatus() {
@@ -49,6 +112,21 @@ uint8_t GP22::getMeasuredHits(Channel channel) {
 uint8_t GP22::getReadPointer() {
   return _status & 0x0007;
 }
+uint16_t GP22::getStatus() {
+  return _status;
+}
+bool GP22::waitForResult(uint16_t maxPolls) {
+  // The init opcode resets the read pointer, and it is moved on
+  // each time the ALU writes a result, so it is our "done" flag.
+  for (uint16_t i = 0; i < maxPolls; i++) {
+    readStatus();
+    if (timedOut())
+      return false;
+    if (getReadPointer() > 0)
+      return true;
+  }
+  return false;
+}
 
 //Function to read from result registers (as a signed int, as MM1 uses 2's comp)
 int32_t GP22::readResult(uint8_t resultRegister) {
@@ -64,27 +142,52 @@ int32_t GP22::readResult(uint8_t resultRegister) {
 }
 
 // These are the functions designed to make tranfers quick enough to work
-// by sending the opcode and immediatly following with data (using SPI_CONTINUE).
+// by sending the opcode and immediatly following with data (holding the select).
+// Reads are urgent, config writes can wait, so that is the bus priority.
+void GP22::transferOpcode(uint8_t opcode, BusPriority priority) {
+  busAcquire(priority);
+  _transport->transfer(_ssPin, opcode, true);
+  _spiBytes += 1;
+  if (_recorder)
+    _recorder->record(_recorderSource, opcode, 0, 0, 0);
+  busRelease();
+}
 uint8_t GP22::transfer1B(uint8_t opcode, uint8_t byte1) {
   FourByte data = { 0 };
-  SPI.transfer(_ssPin, opcode, SPI_CONTINUE);
-  data.bit8[0] = SPI.transfer(_ssPin, byte1);
+  busAcquire(TDC_PRIORITY);
+  _transport->transfer(_ssPin, opcode, false);
+  data.bit8[0] = _transport->transfer(_ssPin, byte1, true);
+  _spiBytes += 2;
+  if (_recorder)
+    _recorder->record(_recorderSource, opcode, 1, (uint32_t)byte1 << 24, (uint32_t)data.bit8[0] << 24);
+  busRelease();
   return data.bit8[0];
 }
 uint16_t GP22::transfer2B(uint8_t opcode, uint8_t byte1, uint8_t byte2) {
   FourByte data = { 0 };
-  SPI.transfer(_ssPin, opcode, SPI_CONTINUE);
-  data.bit8[1] = SPI.transfer(_ssPin, byte1, SPI_CONTINUE);
-  data.bit8[0] = SPI.transfer(_ssPin, byte2);
+  busAcquire(TDC_PRIORITY);
+  _transport->transfer(_ssPin, opcode, false);
+  data.bit8[1] = _transport->transfer(_ssPin, byte1, false);
+  data.bit8[0] = _transport->transfer(_ssPin, byte2, true);
+  _spiBytes += 3;
+  if (_recorder)
+    _recorder->record(_recorderSource, opcode, 2, ((uint32_t)byte1 << 24) | ((uint32_t)byte2 << 16), (uint32_t)data.bit16[0] << 16);
+  busRelease();
   return data.bit16[0];
 }
 uint32_t GP22::transfer4B(uint8_t opcode, uint8_t byte1, uint8_t byte2, uint8_t byte3, uint8_t byte4) {
   FourByte data = { 0 };
-  SPI.transfer(_ssPin, opcode, SPI_CONTINUE);
-  data.bit8[3] = SPI.transfer(_ssPin, byte1, SPI_CONTINUE);
-  data.bit8[2] = SPI.transfer(_ssPin, byte2, SPI_CONTINUE);
-  data.bit8[1] = SPI.transfer(_ssPin, byte3, SPI_CONTINUE);
-  data.bit8[0] = SPI.transfer(_ssPin, byte4);
+  // The only 4 byte writes are to the config registers
+  busAcquire((opcode & 0xF0) == 0x80 ? BULK_PRIORITY : TDC_PRIORITY);
+  _transport->transfer(_ssPin, opcode, false);
+  data.bit8[3] = _transport->transfer(_ssPin, byte1, false);
+  data.bit8[2] = _transport->transfer(_ssPin, byte2, false);
+  data.bit8[1] = _transport->transfer(_ssPin, byte3, false);
+  data.bit8[0] = _transport->transfer(_ssPin, byte4, true);
+  _spiBytes += 5;
+  if (_recorder)
+    _recorder->record(_recorderSource, opcode, 4, ((uint32_t)byte1 << 24) | ((uint32_t)byte2 << 16) | ((uint32_t)byte3 << 8) | byte4, data.bit32);
+  busRelease();
   return data.bit32;
 }
 
@@ -103,6 +206,12 @@ float GP22::measConv(int32_t input) {
   // Use the precalculated conversion factor.
   return ((float)input) * _conversionFactorRead;
 }
+float GP22::delayConv(uint32_t input) {
+  return ((float)input) * _conversionFactorDelay;
+}
+float GP22::getConversionFactor() {
+  return _conversionFactorRead;
+}
 
 void GP22::updateConversionFactors() {
   // This number takes cycles to calculate, so precalculate it.
@@ -130,6 +239,18 @@ void GP22::updateConfig() {
   // I know, this is a bit cheeky, but I just really wanted to try it...
   for (uint8_t i = 0; i < 7; i++)
     transfer4B((0x80 + i), _config[i][0], _config[i][1], _config[i][2], _config[i][3]);
+  _configGeneration++;
+}
+
+void GP22::writeRegister(uint8_t reg) {
+  if (reg > 6)
+    return;
+  transfer4B((0x80 + reg), _config[reg][0], _config[reg][1], _config[reg][2], _config[reg][3]);
+  _configGeneration++;
+}
+
+uint32_t GP22::getConfigGeneration() {
+  return _configGeneration;
 }
 
 void GP22::getConfig(uint32_t * arrayToFill) {
@@ -139,6 +260,28 @@ void GP22::getConfig(uint32_t * arrayToFill) {
     arrayToFill[i] = (_config[i][0] << 24) + (_config[i][1] << 16) + (_config[i][2] << 8) + _config[i][3];
 }
 
+void GP22::setConfig(const uint32_t * config) {
+  // Split the 32 bit registers back into bytes, most significant first
+  for (uint8_t i = 0; i < 7; i++) {
+    _config[i][0] = config[i] >> 24;
+    _config[i][1] = config[i] >> 16;
+    _config[i][2] = config[i] >> 8;
+    _config[i][3] = config[i];
+  }
+
+  // The clock settings may well have changed
+  updateConversionFactors();
+}
+
+void GP22::setRecorder(GP22Recorder * recorder, uint8_t source) {
+  _recorder = recorder;
+  _recorderSource = source;
+}
+
+uint32_t GP22::getSpiByteCount() {
+  return _spiBytes;
+}
+
 //// The config setting/getting functions
 
 // Measurement mode selection
@@ -165,7 +308,11 @@ void GP22::setMeasurementMode(uint8_t mode) {
   _config[0][2] = configPiece;
 }
 uint8_t GP22::getMeasurementMode() {
-  return (_config[0][2] & B00001000) > 0;
+  // MESSB2 = 0 is mode 1, MESSB2 = 1 is mode 2
+  if ((_config[0][2] & B00001000) > 0)
+    return 2;
+  else
+    return 1;
 }
 
 // This is for the measurement mode 1 clock pre-divider
@@ -253,6 +400,7 @@ void GP22::updateALUInstruction(ALUInstruction instruction) {
   // as this is quicker than doing everything...
   // The config register with the operators is Reg 1, so update that one!
   transfer4B((0x81), _config[1][0], _config[1][1], _config[1][2], _config[1][3]);
+  _configGeneration++;
 }
 
 // Define HIT operators for ALU processing
@@ -535,4 +683,28 @@ int8_t GP22::getFirstWaveOffset() {
   }
 
   return offset;
-}
\ No newline at end of file
+}
+
+void GP22::setStopMask(uint8_t stop, uint32_t delay) {
+  // DELVAL1-3 are in bits 8-26 of registers 2-4 respectively
+  if (stop < 1 || stop > 3)
+    return;
+  uint8_t reg = stop + 1;
+
+  // Only 19 bits are available
+  if (delay > 0x7FFFF)
+    delay = 0x7FFFF;
+
+  // The top three bits go in the bottom of the first byte,
+  // the rest fill the next two bytes.
+  _config[reg][0] = (_config[reg][0] & B11111000) | (uint8_t)(delay >> 16);
+  _config[reg][1] = (uint8_t)(delay >> 8);
+  _config[reg][2] = (uint8_t)delay;
+}
+uint32_t GP22::getStopMask(uint8_t stop) {
+  if (stop < 1 || stop > 3)
+    return 0;
+  uint8_t reg = stop + 1;
+
+  return ((uint32_t)(_config[reg][0] & B00000111) << 16) + ((uint32_t)_config[reg][1] << 8) + _config[reg][2];
+}
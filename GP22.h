@@ -3,7 +3,12 @@
 
 #include "stdlib.h"
 #include "stdint.h"
-#include "SPI.h"
+#include "GP22Transport.h"
+#include "GP22Bus.h"
+#include "GP22Recorder.h"
+
+// The reference clock the GP22 is run from, in Hz
+#define GP22_REF_CLOCK_HZ 4000000UL
 
 // Make it easy to mention the channels
 enum Channel: uint8_t {
@@ -17,6 +22,15 @@ union FourByte {
   uint8_t bit8[4];
 };
 
+// Everything the driver needs to pick up where it left off after a reset,
+// without redoing begin(). See GP22Snapshot for keeping it safe.
+struct GP22State {
+  uint32_t config[7];
+  uint32_t configGeneration;
+  float conversionFactorRead;
+  float conversionFactorDelay;
+};
+
 struct ALUInstruction {
   int id;
   uint8_t hit1Op;
@@ -34,9 +48,30 @@ public:
   // Start communicating. Transfers the config over as well so call this
   // after configuring the settings as required.
   void begin();
+  // Start communicating with a chip that has already been set up (e.g. the
+  // MCU was reset but the GP22 wasn't). If the chip still has the config
+  // from the state, it is left alone, otherwise this falls back to begin()
+  // and returns false. Only the top byte of register 1 can be read back, so
+  // that is all that is checked.
+  bool resume(const GP22State &state);
+  // Save the driver state, for resume()
+  void saveState(GP22State &state);
+
+  // Share the SPI bus with other devices (and threads) through an arbiter.
+  // This also picks which SPI controller the chip is on (the bus's one).
+  // Call this before begin(). Without one the default SPI is used directly
+  // (and is shut down with the chip, on a bus that's left to GP22Bus::end()).
+  void setBus(GP22Bus * bus);
+  GP22Bus * getBus();
+  // Hold the bus over a batch of transfers, so nothing else gets in between.
+  // Each lockBus() needs an unlockBus(). Does nothing without a bus.
+  void lockBus(BusPriority priority);
+  void unlockBus();
 
   // Initialise the GP22, then it waits for an event to measure.
   void measure();
+  // Start a temperature measurement (the results go in registers 0-3).
+  void measureTemperature();
 
   /// Status related functions
   // Read the GP22s status register into memory.
@@ -48,6 +83,11 @@ public:
   uint8_t getMeasuredHits(Channel channel);
   // What is the current read register pointer?
   uint8_t getReadPointer();
+  // The whole status register, as of the last readStatus()
+  uint16_t getStatus();
+  // Poll the status until the ALU has written a result (true) or the
+  // measurement timed out or maxPolls status reads went by (false).
+  bool waitForResult(uint16_t maxPolls);
 
   // The measurement reading command
   int32_t readResult(uint8_t resultRegister);
@@ -58,6 +98,10 @@ public:
   // This is the conversion function which takes a raw input
   // and converts it to microseconds
   float measConv(int32_t input);
+  // The same for the delay (stop masking) values, which are Q14.5 clocks
+  float delayConv(uint32_t input);
+  // The microseconds per raw result LSB that measConv() uses
+  float getConversionFactor();
 
   //// These are the config setting/getting functions
   /// This is for the number of expected hits, can be 2-4
@@ -118,6 +162,16 @@ public:
   void setFirstWaveOffset(int8_t offset);
   int8_t getFirstWaveOffset();
 
+  /// Stop masking settings
+  // The stops are ignored until this long after the start (DELVAL1-3).
+  // The delay is in reference clock periods as a Q14.5 number, so 19 bits.
+  // Stop 2 and 3 share their bits with the first wave settings, so only use
+  // them with first wave mode off. A delay of 0 turns the masking off.
+  void setStopMask(uint8_t stop, uint32_t delay);
+  uint32_t getStopMask(uint8_t stop);
+
+  // Write just one config register (0-6) to the GP22, e.g. to repair it.
+  void writeRegister(uint8_t reg);
   // This writes the config register to the GP22.
   // Call this after changing any of the settings to update them on the GP22 itself.
   // (You can do a series of settings changes and call this at the end.)
@@ -125,10 +179,25 @@ public:
 
   // Will fill a 7 by 32 bit array with the config registers
   void getConfig(uint32_t * arrayToFill);
+  // The reverse of getConfig, loads a 7 by 32 bit config image.
+  // As with the setters, call updateConfig() to send it to the GP22.
+  void setConfig(const uint32_t * config);
+  // This goes up by one every time config is written to the GP22, so
+  // results can be matched up with the config they were taken with.
+  uint32_t getConfigGeneration();
+
+  // The number of bytes that have gone over SPI (it wraps around), for
+  // working out the bus budget of a measurement scheme.
+  uint32_t getSpiByteCount();
+
+  // Record every SPI transaction into a flight recorder, tagged with source
+  // (to tell chips apart when they share one). NULL stops recording.
+  void setRecorder(GP22Recorder * recorder, uint8_t source = 0);
     
 private:
 
   // The fast SPI transfer functions
+  void transferOpcode(uint8_t opcode, BusPriority priority);
   uint8_t transfer1B(uint8_t opcode, uint8_t byte1);
   uint16_t transfer2B(uint8_t opcode, uint8_t byte1, uint8_t byte2);
   uint32_t transfer4B(uint8_t opcode, uint8_t byte1, uint8_t byte2, uint8_t byte3, uint8_t byte4);
@@ -136,6 +205,19 @@ private:
   // The slave select pin used by SPI to communicate with the GP22
   int _ssPin;
   uint16_t _status;
+  uint32_t _spiBytes = 0;
+  uint32_t _configGeneration = 0;
+
+  // The shared bus, if there is one, and the SPI controller in use
+  GP22Bus * _bus = NULL;
+  GP22Transport * _transport = &gp22DefaultTransport();
+
+  GP22Recorder * _recorder = NULL;
+  uint8_t _recorderSource = 0;
+  void busAcquire(BusPriority priority);
+  void busRelease();
+  void setupSPI();
+  static void applyBusSettings(void * gp22);
 
   // Have the conversion from the raw result to time precalculated.
   void updateConversionFactors();
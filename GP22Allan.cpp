@@ -0,0 +1,107 @@
+#include "GP22Allan.h"
+#include "math.h"
+
+GP22Allan::GP22Allan() {
+  _microsPerLsb = 0;
+  reset();
+}
+
+void GP22Allan::reset() {
+  _samples = 0;
+  _nominal = 0;
+  _phase = 0;
+  for (uint8_t i = 0; i < GP22_ALLAN_MAX_LEVELS; i++) {
+    _historyHead[i] = 0;
+    _historyCount[i] = 0;
+    _sumSquares[i] = 0;
+    _terms[i] = 0;
+  }
+}
+
+void GP22Allan::setTimeBase(float microsPerLsb) {
+  _microsPerLsb = microsPerLsb;
+}
+
+void GP22Allan::addPeriod(int32_t period) {
+  if (_samples == 0) {
+    // Everything is measured relative to the first period, and the phase
+    // starts at zero (which is a sample for every level).
+    _nominal = period;
+    _phase = 0;
+    for (uint8_t i = 0; i < GP22_ALLAN_MAX_LEVELS; i++) {
+      _history[i][0] = 0;
+      _historyHead[i] = 0;
+      _historyCount[i] = 1;
+    }
+  }
+
+  _phase += (int64_t)period - _nominal;
+  _samples++;
+
+  for (uint8_t level = 0; level < GP22_ALLAN_MAX_LEVELS; level++) {
+    // The short taus use every phase sample, the rest are decimated so that
+    // tau is always GP22_ALLAN_LAG samples back in the history.
+    uint32_t stride;
+    uint8_t lag;
+    if (level <= GP22_ALLAN_OVERLAP_BITS) {
+      stride = 1;
+      lag = 1 << level;
+    } else {
+      stride = (uint32_t)1 << (level - GP22_ALLAN_OVERLAP_BITS);
+      lag = GP22_ALLAN_LAG;
+    }
+
+    // The strides are powers of two, so if this level doesn't want the
+    // sample then none of the higher ones will either.
+    if ((_samples & (stride - 1)) != 0)
+      break;
+
+    uint8_t head = _historyHead[level] + 1;
+    if (head >= GP22_ALLAN_HISTORY)
+      head = 0;
+    _history[level][head] = _phase;
+    _historyHead[level] = head;
+    _historyCount[level]++;
+
+    if (_historyCount[level] > (uint32_t)2 * lag) {
+      uint8_t back1 = (head + GP22_ALLAN_HISTORY - lag) % GP22_ALLAN_HISTORY;
+      uint8_t back2 = (head + GP22_ALLAN_HISTORY - 2 * lag) % GP22_ALLAN_HISTORY;
+      int64_t d = _phase - 2 * _history[level][back1] + _history[level][back2];
+      _sumSquares[level] += (double)d * (double)d;
+      _terms[level]++;
+    }
+  }
+}
+
+uint32_t GP22Allan::getSampleCount() {
+  return _samples;
+}
+
+uint8_t GP22Allan::getNumLevels() {
+  uint8_t levels = 0;
+  while (levels < GP22_ALLAN_MAX_LEVELS && _terms[levels] > 0)
+    levels++;
+  return levels;
+}
+
+float GP22Allan::getTau(uint8_t level) {
+  if (level >= GP22_ALLAN_MAX_LEVELS)
+    return 0;
+  return (float)((double)_nominal * (double)((uint32_t)1 << level) * _microsPerLsb);
+}
+
+double GP22Allan::getDeviation(uint8_t level) {
+  if (level >= GP22_ALLAN_MAX_LEVELS || _terms[level] == 0 || _nominal == 0)
+    return 0;
+
+  // AVAR = <d^2> / (2 tau^2), with tau in the same raw units as the phase.
+  double tau = (double)_nominal * (double)((uint32_t)1 << level);
+  return sqrt(_sumSquares[level] / (2.0 * _terms[level])) / tau;
+}
+
+uint32_t GP22Allan::getTermCount(uint8_t level) {
+  if (level < GP22_ALLAN_MAX_LEVELS)
+    return _terms[level];
+  else
+    return 0;
+}
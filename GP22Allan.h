@@ -0,0 +1,62 @@
+#ifndef GP22Allan_h
+#define GP22Allan_h
+
+#include "stdint.h"
+
+// How many octaves of tau are tracked (tau = 2^level periods)
+#define GP22_ALLAN_MAX_LEVELS 20
+// Each level keeps 2^GP22_ALLAN_OVERLAP_BITS phase samples per tau, which
+// sets how much the second differences overlap at the longer taus.
+#define GP22_ALLAN_OVERLAP_BITS 2
+#define GP22_ALLAN_LAG (1 << GP22_ALLAN_OVERLAP_BITS)
+#define GP22_ALLAN_HISTORY (2 * GP22_ALLAN_LAG + 1)
+
+// A streaming overlapping Allan deviation calculator for period measurements.
+// The periods (raw Q16.16 results) are integrated into phase, and for each
+// octave tau = 2^k periods the second difference of the phase is taken at a
+// stride of tau / 2^GP22_ALLAN_OVERLAP_BITS (or every sample, for short taus).
+// Memory is a fixed history per octave, so O(log N) overall, and the
+// amortised work per sample is constant.
+//
+// It doesn't depend on the GP22 class, so recordings can be run through it on
+// a PC just as well as on the target.
+class GP22Allan
+{
+public:
+  GP22Allan();
+
+  // Start again from nothing.
+  void reset();
+
+  // The microseconds per raw LSB, used for reporting tau. On the target this
+  // is GP22::getConversionFactor().
+  void setTimeBase(float microsPerLsb);
+
+  // Add a measured period (raw result).
+  void addPeriod(int32_t period);
+
+  uint32_t getSampleCount();
+  // How many levels currently have at least one second difference
+  uint8_t getNumLevels();
+  // Tau for a level, in microseconds
+  float getTau(uint8_t level);
+  // The Allan deviation (fractional, so dimensionless) for a level
+  double getDeviation(uint8_t level);
+  // How many second differences the deviation of a level is based on
+  uint32_t getTermCount(uint8_t level);
+
+private:
+  float _microsPerLsb;
+  uint32_t _samples;
+  // The first period is the nominal one, the phase is relative to it.
+  int32_t _nominal;
+  int64_t _phase;
+
+  int64_t _history[GP22_ALLAN_MAX_LEVELS][GP22_ALLAN_HISTORY];
+  uint8_t _historyHead[GP22_ALLAN_MAX_LEVELS];
+  uint32_t _historyCount[GP22_ALLAN_MAX_LEVELS];
+  double _sumSquares[GP22_ALLAN_MAX_LEVELS];
+  uint32_t _terms[GP22_ALLAN_MAX_LEVELS];
+};
+
+#endif
@@ -0,0 +1,231 @@
+#include "GP22Archive.h"
+
+GP22Archive::GP22Archive(Print &out, uint64_t offset) : _out(out) {
+  _offset = offset;
+  _count = 0;
+  _lastTime = INT64_MIN;
+  _indexCount = 0;
+  _lastPage = GP22_ARCHIVE_NO_PAGE;
+  _blocks = 0;
+  _buffered = 0;
+  _crc = 0xFFFF;
+}
+
+void GP22Archive::begin() {
+  const uint8_t header[GP22_ARCHIVE_FILE_HEADER] = { 'G', 'P', 'A', 'R', GP22_ARCHIVE_VERSION, 0, 0, 0 };
+  putBytes(header, GP22_ARCHIVE_FILE_HEADER);
+  drain();
+}
+
+bool GP22Archive::add(int64_t time, int32_t result, uint16_t status, uint32_t configGeneration) {
+  if (time < _lastTime)
+    return false;
+  _lastTime = time;
+
+  _times[_count] = time;
+  _results[_count] = result;
+  _statuses[_count] = status;
+  _generations[_count] = configGeneration;
+  _count++;
+
+  if (_count == GP22_ARCHIVE_BLOCK_RECORDS)
+    writeBlock();
+  return true;
+}
+
+void GP22Archive::flush() {
+  if (_count > 0)
+    writeBlock();
+}
+
+void GP22Archive::close() {
+  flush();
+  if (_indexCount > 0)
+    writeIndexPage();
+
+  uint8_t trailer[GP22_ARCHIVE_TRAILER];
+  gp22PutLE64(trailer, _lastPage);
+  gp22PutLE32(trailer + 8, _blocks);
+  trailer[12] = 'G';
+  trailer[13] = 'P';
+  trailer[14] = 'A';
+  trailer[15] = 'T';
+  putBytes(trailer, GP22_ARCHIVE_TRAILER);
+  drain();
+}
+
+void GP22Archive::writeBlock() {
+  GP22ArchiveIndexEntry &entry = _index[_indexCount];
+  entry.offset = _offset + _buffered;
+  entry.count = _count;
+  entry.good = 0;
+  entry.minTime = _times[0];
+  entry.maxTime = _times[_count - 1];
+  entry.minResult = INT32_MAX;
+  entry.maxResult = INT32_MIN;
+  entry.sum = 0;
+
+  // The column sizes have to go in the header, so work them out first
+  uint16_t timeLength = 0;
+  uint16_t resultLength = 0;
+  int64_t step = 0;
+  for (uint16_t i = 1; i < _count; i++) {
+    int64_t nextStep = _times[i] - _times[i - 1];
+    timeLength += gp22VarintLength(gp22ZigZag(nextStep - step));
+    step = nextStep;
+    resultLength += gp22VarintLength(gp22ZigZag((int64_t)_results[i] - _results[i - 1]));
+  }
+
+  // The statistics, only over the results that didn't time out
+  for (uint16_t i = 0; i < _count; i++) {
+    if (_statuses[i] & 0x0600)
+      continue;
+    entry.good++;
+    entry.sum += _results[i];
+    if (_results[i] < entry.minResult)
+      entry.minResult = _results[i];
+    if (_results[i] > entry.maxResult)
+      entry.maxResult = _results[i];
+  }
+  entry.sumSquares = 0;
+  for (uint16_t i = 0; i < _count; i++) {
+    if (_statuses[i] & 0x0600)
+      continue;
+    uint64_t difference = (int64_t)_results[i] - entry.minResult;
+    entry.sumSquares += difference * difference;
+  }
+  if (entry.good == 0) {
+    entry.minResult = 0;
+    entry.maxResult = 0;
+  }
+
+  uint8_t header[GP22_ARCHIVE_BLOCK_HEADER];
+  header[0] = 'G';
+  header[1] = 'P';
+  header[2] = 'A';
+  header[3] = 'B';
+  gp22PutLE16(header + 4, _count);
+  gp22PutLE16(header + 6, timeLength);
+  gp22PutLE16(header + 8, resultLength);
+  gp22PutLE16(header + 10, runsLength(_statuses));
+  gp22PutLE16(header + 12, runsLength(_generations));
+  gp22PutLE64(header + 14, _times[0]);
+  gp22PutLE32(header + 22, _results[0]);
+
+  startCrc();
+  putBytes(header, GP22_ARCHIVE_BLOCK_HEADER);
+  step = 0;
+  for (uint16_t i = 1; i < _count; i++) {
+    int64_t nextStep = _times[i] - _times[i - 1];
+    putVarint(gp22ZigZag(nextStep - step));
+    step = nextStep;
+  }
+  for (uint16_t i = 1; i < _count; i++)
+    putVarint(gp22ZigZag((int64_t)_results[i] - _results[i - 1]));
+  putRuns(_statuses);
+  putRuns(_generations);
+  putCrc();
+  drain();
+
+  _count = 0;
+  _blocks++;
+  _indexCount++;
+  if (_indexCount == GP22_ARCHIVE_INDEX_BLOCKS)
+    writeIndexPage();
+}
+
+void GP22Archive::writeIndexPage() {
+  uint64_t page = _offset + _buffered;
+
+  uint8_t bytes[GP22_ARCHIVE_INDEX_ENTRY];
+  bytes[0] = 'G';
+  bytes[1] = 'P';
+  bytes[2] = 'A';
+  bytes[3] = 'I';
+  gp22PutLE16(bytes + 4, _indexCount);
+  gp22PutLE16(bytes + 6, 0);
+  gp22PutLE64(bytes + 8, _lastPage);
+
+  startCrc();
+  putBytes(bytes, GP22_ARCHIVE_INDEX_HEADER);
+  for (uint8_t i = 0; i < _indexCount; i++) {
+    gp22ArchiveEncodeEntry(bytes, _index[i]);
+    putBytes(bytes, GP22_ARCHIVE_INDEX_ENTRY);
+  }
+  putCrc();
+  drain();
+
+  _lastPage = page;
+  _indexCount = 0;
+}
+
+uint16_t GP22Archive::runsLength(const uint32_t * values) {
+  uint16_t length = 0;
+  uint16_t start = 0;
+  for (uint16_t i = 1; i <= _count; i++) {
+    if (i == _count || values[i] != values[start]) {
+      length += gp22VarintLength(values[start]) + gp22VarintLength(i - start);
+      start = i;
+    }
+  }
+  return length;
+}
+
+void GP22Archive::putRuns(const uint32_t * values) {
+  uint16_t start = 0;
+  for (uint16_t i = 1; i <= _count; i++) {
+    if (i == _count || values[i] != values[start]) {
+      putVarint(values[start]);
+      putVarint(i - start);
+      start = i;
+    }
+  }
+}
+
+void GP22Archive::put(uint8_t byte) {
+  if (_buffered == sizeof(_buffer))
+    drain();
+  _buffer[_buffered++] = byte;
+}
+void GP22Archive::putBytes(const uint8_t * bytes, uint8_t length) {
+  for (uint8_t i = 0; i < length; i++)
+    put(bytes[i]);
+}
+void GP22Archive::putVarint(uint64_t value) {
+  while (value >= 0x80) {
+    put((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  put(value);
+}
+
+void GP22Archive::startCrc() {
+  // The CRC is kept over what has been drained, so start on a clean buffer
+  drain();
+  _crc = 0xFFFF;
+}
+void GP22Archive::putCrc() {
+  _crc = gp22Crc16(_buffer, _buffered, _crc);
+  uint16_t crc = _crc;
+  _out.write(_buffer, _buffered);
+  _offset += _buffered;
+  _buffered = 0;
+  put(crc);
+  put(crc >> 8);
+}
+
+void GP22Archive::drain() {
+  if (_buffered == 0)
+    return;
+  _crc = gp22Crc16(_buffer, _buffered, _crc);
+  _out.write(_buffer, _buffered);
+  _offset += _buffered;
+  _buffered = 0;
+}
+
+uint64_t GP22Archive::getBytesWritten() {
+  return _offset + _buffered;
+}
+uint32_t GP22Archive::getBlockCount() {
+  return _blocks;
+}
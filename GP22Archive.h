@@ -0,0 +1,76 @@
+#ifndef GP22Archive_h
+#define GP22Archive_h
+
+#include "stdint.h"
+#include "Print.h"
+#include "GP22ArchiveFormat.h"
+
+// Writes measurements to a columnar archive (see GP22ArchiveFormat.h for
+// the layout), e.g. on an SD card, for long term storage and quick range
+// queries on a PC (extras/linux/gp22_archive_query).
+//
+// The records of a block are buffered in RAM, then the columns are each
+// delta or run length encoded and written out in one go, so a steady 1 kHz
+// stream takes about 3 bytes a record on disk rather than the 20 (8 time,
+// 4 result, 4 status, 4 generation) it takes in RAM. The index is kept
+// for a page of blocks at a time and written after them, so the RAM used
+// doesn't grow with the file.
+//
+// The times are whatever 64 bit time the sketch keeps (e.g. us since the
+// epoch), but they must not go backwards.
+class GP22Archive
+{
+public:
+  // offset is where in the file the archive starts, if it isn't the start
+  GP22Archive(Print &out, uint64_t offset = 0);
+
+  // Write the file header.
+  void begin();
+
+  // Add a measurement. Returns false if it was dropped (time going backwards).
+  bool add(int64_t time, int32_t result, uint16_t status, uint32_t configGeneration);
+
+  // Write out the block so far, e.g. before the card is synced.
+  void flush();
+  // Write out everything, the last index page and the trailer.
+  void close();
+
+  uint64_t getBytesWritten();
+  uint32_t getBlockCount();
+
+private:
+  void writeBlock();
+  void writeIndexPage();
+
+  // Buffered output, which also keeps the CRC
+  void put(uint8_t byte);
+  void putBytes(const uint8_t * bytes, uint8_t length);
+  void putVarint(uint64_t value);
+  void startCrc();
+  void putCrc();
+  void drain();
+
+  uint16_t runsLength(const uint32_t * values);
+  void putRuns(const uint32_t * values);
+
+  Print &_out;
+  uint64_t _offset;
+
+  int64_t _times[GP22_ARCHIVE_BLOCK_RECORDS];
+  int32_t _results[GP22_ARCHIVE_BLOCK_RECORDS];
+  uint32_t _statuses[GP22_ARCHIVE_BLOCK_RECORDS];
+  uint32_t _generations[GP22_ARCHIVE_BLOCK_RECORDS];
+  uint16_t _count;
+  int64_t _lastTime;
+
+  GP22ArchiveIndexEntry _index[GP22_ARCHIVE_INDEX_BLOCKS];
+  uint8_t _indexCount;
+  uint64_t _lastPage;
+  uint32_t _blocks;
+
+  uint8_t _buffer[64];
+  uint8_t _buffered;
+  uint16_t _crc;
+};
+
+#endif
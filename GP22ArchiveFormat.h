@@ -0,0 +1,205 @@
+#ifndef GP22ArchiveFormat_h
+#define GP22ArchiveFormat_h
+
+#include "stdint.h"
+#include "stddef.h"
+#include "GP22TelemetryFormat.h"
+#include "GP22Crc.h"
+
+// The columnar archive format, shared by the writer on the target
+// (GP22Archive) and the readers on the PC (extras/linux).
+//
+// All little endian. The file is:
+//   file header: magic "GPAR" (4), version (1), 3 reserved bytes
+//   blocks and index pages, in the order they were written
+//   trailer: offset of the last index page (8), block count (4), magic "GPAT" (4)
+//
+// A block holds up to GP22_ARCHIVE_BLOCK_RECORDS records as four columns:
+//   magic "GPAB" (4), record count (2), the byte lengths of the time,
+//   result, status and generation columns (2 each), first time (8),
+//   first result (4), the columns, CRC-16 of everything before it (2)
+// The columns are:
+//   time: the change in the time step from record to record (so a steady
+//     rate is all zeros), zigzag varints, for records 1 onwards
+//   result: the change from the last record, zigzag varints, records 1 onwards
+//   status, generation: runs of (value varint, run length varint)
+//
+// An index page has an entry for each of the blocks since the last page:
+//   magic "GPAI" (4), entry count (2), reserved (2), offset of the previous
+//   page (8, all ones for the first), the entries, CRC-16 (2)
+// and each entry is (see GP22ArchiveIndexEntry):
+//   block offset (8), record count (2), good record count (2), min time (8),
+//   max time (8), min result (4), max result (4), result sum (8),
+//   sum of (result - min result)^2 (8)
+// The statistics only cover good results (no timeout in the status).
+//
+// Readers start at the trailer and follow the pages back, so a range query
+// only has to read the index and the blocks that overlap it. If the writer
+// never got to close the file there is no trailer, but the blocks can still
+// be found by scanning, as each one is self contained.
+
+#define GP22_ARCHIVE_VERSION 1
+#define GP22_ARCHIVE_FILE_HEADER 8
+#define GP22_ARCHIVE_BLOCK_HEADER 26
+#define GP22_ARCHIVE_INDEX_HEADER 16
+#define GP22_ARCHIVE_INDEX_ENTRY 52
+#define GP22_ARCHIVE_TRAILER 16
+#define GP22_ARCHIVE_NO_PAGE 0xFFFFFFFFFFFFFFFFULL
+
+// Records per block (the writer buffers one block in RAM, 20 bytes a record)
+#ifndef GP22_ARCHIVE_BLOCK_RECORDS
+#define GP22_ARCHIVE_BLOCK_RECORDS 256
+#endif
+// Blocks per index page
+#ifndef GP22_ARCHIVE_INDEX_BLOCKS
+#define GP22_ARCHIVE_INDEX_BLOCKS 32
+#endif
+
+struct GP22ArchiveIndexEntry {
+  uint64_t offset;
+  uint16_t count;
+  uint16_t good;
+  int64_t minTime;
+  int64_t maxTime;
+  int32_t minResult;
+  int32_t maxResult;
+  int64_t sum;
+  uint64_t sumSquares;
+};
+
+inline void gp22PutLE64(uint8_t * out, uint64_t value) {
+  gp22PutLE32(out, (uint32_t)value);
+  gp22PutLE32(out + 4, (uint32_t)(value >> 32));
+}
+inline uint64_t gp22GetLE64(const uint8_t * in) {
+  return (uint64_t)gp22GetLE32(in) | ((uint64_t)gp22GetLE32(in + 4) << 32);
+}
+
+// Zigzag maps small negative and positive numbers to small unsigned ones
+inline uint64_t gp22ZigZag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+inline int64_t gp22UnZigZag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+inline uint8_t gp22VarintLength(uint64_t value) {
+  uint8_t length = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    length++;
+  }
+  return length;
+}
+// Read a varint, not going past end. Returns NULL if it runs off the end.
+inline const uint8_t * gp22GetVarint(const uint8_t * in, const uint8_t * end, uint64_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; in < end && shift < 64; shift += 7) {
+    uint8_t byte = *in++;
+    value |= (uint64_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+      return in;
+  }
+  return NULL;
+}
+
+inline void gp22ArchiveEncodeEntry(uint8_t * out, const GP22ArchiveIndexEntry &entry) {
+  gp22PutLE64(out, entry.offset);
+  gp22PutLE16(out + 8, entry.count);
+  gp22PutLE16(out + 10, entry.good);
+  gp22PutLE64(out + 12, entry.minTime);
+  gp22PutLE64(out + 20, entry.maxTime);
+  gp22PutLE32(out + 28, entry.minResult);
+  gp22PutLE32(out + 32, entry.maxResult);
+  gp22PutLE64(out + 36, entry.sum);
+  gp22PutLE64(out + 44, entry.sumSquares);
+}
+inline void gp22ArchiveDecodeEntry(const uint8_t * in, GP22ArchiveIndexEntry &entry) {
+  entry.offset = gp22GetLE64(in);
+  entry.count = gp22GetLE16(in + 8);
+  entry.good = gp22GetLE16(in + 10);
+  entry.minTime = gp22GetLE64(in + 12);
+  entry.maxTime = gp22GetLE64(in + 20);
+  entry.minResult = gp22GetLE32(in + 28);
+  entry.maxResult = gp22GetLE32(in + 32);
+  entry.sum = gp22GetLE64(in + 36);
+  entry.sumSquares = gp22GetLE64(in + 44);
+}
+
+// The size of the block at data (which has length bytes available), or 0
+// if it isn't a whole, undamaged block.
+inline size_t gp22ArchiveBlockSize(const uint8_t * data, size_t length) {
+  if (length < GP22_ARCHIVE_BLOCK_HEADER + 2 || data[0] != 'G' || data[1] != 'P' || data[2] != 'A' || data[3] != 'B')
+    return 0;
+  size_t size = GP22_ARCHIVE_BLOCK_HEADER + 2;
+  for (uint8_t i = 0; i < 4; i++)
+    size += gp22GetLE16(data + 6 + 2 * i);
+  if (size > length || gp22GetLE16(data + size - 2) != gp22Crc16(data, size - 2))
+    return 0;
+  return size;
+}
+
+// Decode runs of (value, length) into count values
+inline bool gp22ArchiveDecodeRuns(const uint8_t * in, const uint8_t * end, uint16_t count, uint32_t * values) {
+  uint16_t i = 0;
+  while (i < count) {
+    uint64_t value;
+    uint64_t run;
+    if ((in = gp22GetVarint(in, end, value)) == NULL || (in = gp22GetVarint(in, end, run)) == NULL)
+      return false;
+    if (run == 0 || run > (uint64_t)(count - i))
+      return false;
+    while (run--)
+      values[i++] = (uint32_t)value;
+  }
+  return in == end;
+}
+
+// Decode a block that gp22ArchiveBlockSize() has passed. Each array needs
+// room for GP22_ARCHIVE_BLOCK_RECORDS. Returns the record count, or 0 if the
+// columns don't make sense.
+inline uint16_t gp22ArchiveDecodeBlock(const uint8_t * data, int64_t * times, int32_t * results, uint32_t * statuses, uint32_t * generations) {
+  uint16_t count = gp22GetLE16(data + 4);
+  if (count == 0 || count > GP22_ARCHIVE_BLOCK_RECORDS)
+    return 0;
+
+  const uint8_t * column = data + GP22_ARCHIVE_BLOCK_HEADER;
+  const uint8_t * end[4];
+  for (uint8_t i = 0; i < 4; i++) {
+    end[i] = column + gp22GetLE16(data + 6 + 2 * i);
+    column = end[i];
+  }
+
+  const uint8_t * in = data + GP22_ARCHIVE_BLOCK_HEADER;
+  int64_t time = (int64_t)gp22GetLE64(data + 14);
+  int64_t step = 0;
+  times[0] = time;
+  for (uint16_t i = 1; i < count; i++) {
+    uint64_t value;
+    if ((in = gp22GetVarint(in, end[0], value)) == NULL)
+      return 0;
+    step += gp22UnZigZag(value);
+    time += step;
+    times[i] = time;
+  }
+  if (in != end[0])
+    return 0;
+
+  int32_t result = (int32_t)gp22GetLE32(data + 22);
+  results[0] = result;
+  for (uint16_t i = 1; i < count; i++) {
+    uint64_t value;
+    if ((in = gp22GetVarint(in, end[1], value)) == NULL)
+      return 0;
+    result += (int32_t)gp22UnZigZag(value);
+    results[i] = result;
+  }
+  if (in != end[1])
+    return 0;
+
+  if (!gp22ArchiveDecodeRuns(end[1], end[2], count, statuses) || !gp22ArchiveDecodeRuns(end[2], end[3], count, generations))
+    return 0;
+  return count;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "GP22Array.h"
+
+GP22Array::GP22Array() {
+  _numChips = 0;
+  _broadcast = NULL;
+  _armSpread = 0;
+  for (uint8_t i = 0; i < GP22_ARRAY_MAX_CHIPS; i++)
+    _offsets[i] = 0;
+}
+
+int8_t GP22Array::addChip(GP22 * tdc) {
+  if (_numChips >= GP22_ARRAY_MAX_CHIPS || tdc == NULL)
+    return -1;
+  _chips[_numChips] = tdc;
+
+  // Keep the lock order sorted by bus address (an insertion sort, as there
+  // are only a few chips and they're added once)
+  uintptr_t bus = (uintptr_t)tdc->getBus();
+  uint8_t i = _numChips;
+  while (i > 0 && (uintptr_t)_chips[_lockOrder[i - 1]]->getBus() > bus) {
+    _lockOrder[i] = _lockOrder[i - 1];
+    i--;
+  }
+  _lockOrder[i] = _numChips;
+
+  return _numChips++;
+}
+uint8_t GP22Array::getNumChips() {
+  return _numChips;
+}
+
+void GP22Array::setBroadcast(GP22 * broadcast) {
+  _broadcast = broadcast;
+}
+
+// Chips on the same bus just nest
+void GP22Array::lockBuses() {
+  for (uint8_t i = 0; i < _numChips; i++)
+    _chips[_lockOrder[i]]->lockBus(TDC_PRIORITY);
+}
+void GP22Array::unlockBuses() {
+  for (uint8_t i = _numChips; i > 0; i--)
+    _chips[_lockOrder[i - 1]]->unlockBus();
+}
+
+void GP22Array::measureAll() {
+  if (_numChips == 0)
+    return;
+
+  // Hold the bus(es) over the whole lot, so the opcodes go back to back
+  // and nothing else is half way through a frame with one of the chips
+  lockBuses();
+  uint32_t start = gp22Cycles();
+
+  if (_broadcast) {
+    // One Init opcode that every chip sees at once, so there is no skew
+    _broadcast->measure();
+  } else {
+    for (uint8_t i = 0; i < _numChips; i++)
+      _chips[i]->measure();
+  }
+
+  _armSpread = gp22Cycles() - start;
+  unlockBuses();
+}
+
+uint32_t GP22Array::getArmSpread() {
+  return _armSpread;
+}
+
+uint8_t GP22Array::readAll(int32_t * results, uint8_t resultRegister, uint16_t maxPolls) {
+  uint8_t valid = 0;
+
+  for (uint8_t i = 0; i < _numChips; i++) {
+    // The chips were armed together, so the later ones will mostly be done
+    if (_chips[i]->waitForResult(maxPolls)) {
+      results[i] = correct(i, _chips[i]->readResult(resultRegister));
+      valid |= 1 << i;
+    } else {
+      results[i] = 0;
+    }
+  }
+
+  return valid;
+}
+
+uint16_t GP22Array::calibrate(uint16_t samples, uint8_t resultRegister, uint16_t maxPolls) {
+  if (_numChips == 0)
+    return 0;
+
+  const uint8_t all = (1 << _numChips) - 1;
+  int64_t sums[GP22_ARRAY_MAX_CHIPS] = { 0 };
+  int32_t results[GP22_ARRAY_MAX_CHIPS];
+  uint16_t used = 0;
+
+  for (uint16_t n = 0; n < samples; n++) {
+    measureAll();
+    if (readAll(results, resultRegister, maxPolls) != all)
+      continue;
+    // Put the current offsets back, so calibrating twice gives the same answer
+    for (uint8_t i = 0; i < _numChips; i++)
+      sums[i] += (int64_t)results[i] + _offsets[i] - results[0] - _offsets[0];
+    used++;
+  }
+
+  if (used == 0)
+    return 0;
+
+  for (uint8_t i = 0; i < _numChips; i++) {
+    // Round to nearest
+    int64_t sum = sums[i] + (sums[i] >= 0 ? used / 2 : -(int64_t)(used / 2));
+    _offsets[i] = (int32_t)(sum / used);
+  }
+
+  return used;
+}
+
+int32_t GP22Array::getOffset(uint8_t chip) {
+  if (chip < GP22_ARRAY_MAX_CHIPS)
+    return _offsets[chip];
+  else
+    return 0;
+}
+void GP22Array::setOffset(uint8_t chip, int32_t offset) {
+  if (chip < GP22_ARRAY_MAX_CHIPS)
+    _offsets[chip] = offset;
+}
@@ -0,0 +1,84 @@
+#ifndef GP22Array_h
+#define GP22Array_h
+
+#include "stdint.h"
+#include "GP22.h"
+#include "GP22Cycles.h"
+
+#define GP22_ARRAY_MAX_CHIPS 8
+
+// A group of GP22s that share a start signal, measured together so that the
+// differences between their results can be used directly.
+//
+// measureAll() arms every chip, either with one Init opcode per chip sent
+// back to back (holding the bus so nothing gets in between), or with a
+// single opcode on a broadcast chip select that all of the chips listen to,
+// if the hardware has one. Either way the start shouldn't arrive until
+// they're all armed, and getArmSpread() says how long arming took.
+//
+// The buses are always locked in the same order (by address), so arrays
+// measured from different threads can't deadlock on each other's buses.
+//
+// calibrate() measures the fixed offset of each chip relative to the first
+// one (trace lengths, input delays, ...), with the same start and stops fed
+// to all of them. These offsets are then taken off every result by
+// correct(), so the chips' results are on the same timebase.
+class GP22Array
+{
+public:
+  GP22Array();
+
+  // Returns the chip index, or -1 if the array is full. Put the chip on its
+  // bus first, as the lock order is worked out here.
+  int8_t addChip(GP22 * tdc);
+  uint8_t getNumChips();
+
+  // Arm through a chip select that is wired to every chip (e.g. through an
+  // AND gate on the individual selects). The broadcast is a GP22 of its own
+  // on that select, put on the same bus as the chips, so its opcodes are
+  // arbitrated, counted and recorded like any other. Its begin() resets
+  // and configures all of the chips at once. NULL goes back to arming each
+  // chip in turn.
+  void setBroadcast(GP22 * broadcast);
+
+  // Arm all of the chips.
+  void measureAll();
+  // How long the last measureAll() took from the first chip to the last,
+  // in gp22Cycles() counts (call gp22CyclesBegin() first on the Due).
+  uint32_t getArmSpread();
+
+  // Wait for and read all of the chips' results, with their offsets taken
+  // off. Returns a bit mask of the chips that gave a result.
+  uint8_t readAll(int32_t * results, uint8_t resultRegister, uint16_t maxPolls);
+
+  // Run measurements and set each chip's offset to its average difference
+  // from chip 0. Only measurements where every chip got a result are used.
+  // Returns how many were used (the offsets are left alone if none were).
+  uint16_t calibrate(uint16_t samples, uint8_t resultRegister, uint16_t maxPolls);
+
+  // Take a chip's offset off a raw result, do this before measConv().
+  // This is inline as it sits in the per sample path.
+  int32_t correct(uint8_t chip, int32_t raw) {
+    return raw - _offsets[chip];
+  }
+
+  // The offsets are in raw result units (Q16.16 clock periods), for storing
+  // and restoring calibrations.
+  int32_t getOffset(uint8_t chip);
+  void setOffset(uint8_t chip, int32_t offset);
+
+private:
+  int32_t _offsets[GP22_ARRAY_MAX_CHIPS];
+  uint8_t _numChips;
+
+  void lockBuses();
+  void unlockBuses();
+
+  GP22 * _chips[GP22_ARRAY_MAX_CHIPS];
+  // The chips in the order their buses are locked in
+  uint8_t _lockOrder[GP22_ARRAY_MAX_CHIPS];
+  GP22 * _broadcast;
+  uint32_t _armSpread;
+};
+
+#endif
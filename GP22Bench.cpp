@@ -0,0 +1,157 @@
+#include "GP22Bench.h"
+#include "math.h"
+
+// Two sided 95% Student's t, by degrees of freedom (n - 1) from 1 to 30
+static const float tTable[30] = {
+  12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+  2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+  2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static float studentT95(uint8_t degrees) {
+  if (degrees <= 30)
+    return tTable[degrees - 1];
+  // Close enough to the table (within 0.002) for the rest of the way to 1.96
+  return 1.96 + 2.5 / degrees;
+}
+
+static void emptyBenchmark(void * context) {
+  // Stop the compiler from seeing that this does nothing
+  __asm__ __volatile__("" : : "r"(context) : "memory");
+}
+
+GP22Bench::GP22Bench(Print &out) : _out(out) {
+  _clock = gp22Cycles;
+  _clockHz = GP22_CYCLES_HZ;
+  _numSamples = 31;
+  _warmup = 3;
+  _overhead = 0;
+  _last = GP22BenchResult();
+  _first = true;
+}
+
+void GP22Bench::setClock(GP22BenchClock clock, uint32_t hz) {
+  _clock = clock;
+  _clockHz = hz;
+}
+void GP22Bench::setSamples(uint8_t samples, uint8_t warmup) {
+  if (samples < 1)
+    samples = 1;
+  if (samples > GP22_BENCH_MAX_SAMPLES)
+    samples = GP22_BENCH_MAX_SAMPLES;
+  _numSamples = samples;
+  _warmup = warmup;
+}
+
+void GP22Bench::begin() {
+  gp22CyclesBegin();
+
+  _first = true;
+  _out.print("{\"clock_hz\":");
+  _out.print((unsigned long)_clockHz);
+  _out.print(",\"benchmarks\":[\n");
+}
+
+void GP22Bench::measure(GP22BenchFunction function, void * context, uint16_t iterations) {
+  if (iterations < 1)
+    iterations = 1;
+
+  for (uint8_t sample = 0; sample < _warmup + _numSamples; sample++) {
+    uint32_t start = _clock();
+    for (uint16_t i = 0; i < iterations; i++)
+      function(context);
+    uint32_t cycles = _clock() - start;
+
+    if (sample >= _warmup)
+      _samples[sample - _warmup] = (float)cycles / iterations;
+  }
+}
+
+GP22BenchResult GP22Bench::summarise(float overhead) {
+  GP22BenchResult result;
+  uint8_t n = _numSamples;
+
+  // Insertion sort, there are only a few dozen
+  for (uint8_t i = 1; i < n; i++) {
+    float value = _samples[i];
+    uint8_t j = i;
+    while (j > 0 && _samples[j - 1] > value) {
+      _samples[j] = _samples[j - 1];
+      j--;
+    }
+    _samples[j] = value;
+  }
+
+  float sum = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    _samples[i] -= overhead;
+    sum += _samples[i];
+  }
+  result.mean = sum / n;
+
+  float squares = 0;
+  for (uint8_t i = 0; i < n; i++)
+    squares += (_samples[i] - result.mean) * (_samples[i] - result.mean);
+  // With a handful of samples the normal 1.96 would understate the interval
+  // badly, so use Student's t. One sample has no spread to go on.
+  result.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+  result.ci95 = n > 1 ? studentT95(n - 1) * result.stddev / sqrt((float)n) : 0;
+
+  result.min = _samples[0];
+  if (n % 2)
+    result.median = _samples[n / 2];
+  else
+    result.median = (_samples[n / 2 - 1] + _samples[n / 2]) / 2;
+
+  return result;
+}
+
+bool GP22Bench::run(const char * name, GP22BenchFunction function, void * context, uint16_t iterations) {
+  // The clock reads are shared by the calls in a sample, so the overhead
+  // per call depends on the iteration count. It is best case, so it never
+  // takes off more than it should.
+  measure(emptyBenchmark, NULL, iterations);
+  _overhead = summarise(0).min;
+
+  measure(function, context, iterations);
+  _last = summarise(_overhead);
+
+  if (!_first)
+    _out.print(",\n");
+  _first = false;
+
+  _out.print("{\"name\":\"");
+  _out.print(name);
+  _out.print("\",\"iterations\":");
+  _out.print((unsigned long)iterations);
+  _out.print(",\"samples\":");
+  _out.print((unsigned long)_numSamples);
+  printNumber("overhead", _overhead);
+  printNumber("min", _last.min);
+  printNumber("median", _last.median);
+  printNumber("mean", _last.mean);
+  printNumber("stddev", _last.stddev);
+  printNumber("ci95", _last.ci95);
+  _out.print("}");
+
+  // Anything under a cycle is lost in the overhead
+  return _last.median >= 1;
+}
+
+void GP22Bench::printNumber(const char * name, float value) {
+  _out.print(",\"");
+  _out.print(name);
+  _out.print("\":");
+  _out.print(value, 2);
+}
+
+void GP22Bench::end() {
+  _out.print("\n]}\n");
+}
+
+GP22BenchResult GP22Bench::getLast() {
+  return _last;
+}
+float GP22Bench::getOverhead() {
+  return _overhead;
+}
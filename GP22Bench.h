@@ -0,0 +1,84 @@
+#ifndef GP22Bench_h
+#define GP22Bench_h
+
+#include "stdint.h"
+#include "Print.h"
+#include "GP22Cycles.h"
+
+// The most timed samples per benchmark
+#define GP22_BENCH_MAX_SAMPLES 64
+
+// The code being timed. The context is whatever it needs (the object to
+// call, its arguments, ...).
+typedef void (*GP22BenchFunction)(void * context);
+// Where the cycle counts come from
+typedef uint32_t (*GP22BenchClock)();
+
+// One benchmark's results, in clock cycles per call
+struct GP22BenchResult {
+  float min;
+  float median;
+  float mean;
+  float stddev;
+  // The half width of the 95% confidence interval of the mean (from
+  // Student's t, 0 with only one sample)
+  float ci95;
+};
+
+// A microbenchmark harness for the CPU cost of the library's code, the same
+// on the target and on a PC.
+//
+// Each benchmark is run for a few warm-up samples (to fill the caches and
+// settle the branch predictors), which are thrown away, and then for a
+// number of timed samples of many calls each. The cost of the calls
+// themselves (and of reading the clock, which is spread over the calls in a
+// sample) is measured with an empty function at the same iteration count
+// before each benchmark, and taken off. The median is the number to go by,
+// as interrupts and the like only ever make a sample slower.
+//
+// The results are written out as JSON:
+//   {"clock_hz":84000000,"benchmarks":[
+//   {"name":"measConv","iterations":100,"samples":31,"overhead":...,"min":...,...},
+//   ...]}
+class GP22Bench
+{
+public:
+  GP22Bench(Print &out);
+
+  // Use another clock (e.g. perf_event on Linux). The rate is only for the
+  // output, 0 if it isn't known.
+  void setClock(GP22BenchClock clock, uint32_t hz);
+  // How many timed and warm-up samples to take of each benchmark
+  void setSamples(uint8_t samples, uint8_t warmup);
+
+  // Start the JSON output.
+  void begin();
+  // Time function(context), iterations calls per sample, and write out the
+  // result. Returns false if it was too quick to measure.
+  bool run(const char * name, GP22BenchFunction function, void * context, uint16_t iterations);
+  // Finish the JSON output.
+  void end();
+
+  GP22BenchResult getLast();
+  // The overhead taken off every call in the last benchmark, in cycles
+  float getOverhead();
+
+private:
+  // Fills _samples with cycles per call
+  void measure(GP22BenchFunction function, void * context, uint16_t iterations);
+  GP22BenchResult summarise(float overhead);
+  void printNumber(const char * name, float value);
+
+  Print &_out;
+  GP22BenchClock _clock;
+  uint32_t _clockHz;
+  uint8_t _numSamples;
+  uint8_t _warmup;
+
+  float _samples[GP22_BENCH_MAX_SAMPLES];
+  float _overhead;
+  GP22BenchResult _last;
+  bool _first;
+};
+
+#endif
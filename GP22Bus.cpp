@@ -0,0 +1,129 @@
+#include "GP22Bus.h"
+
+GP22Bus::GP22Bus(GP22Transport &transport) {
+  _transport = &transport;
+  _owner = NULL;
+  _depth = 0;
+  _transactions = 0;
+  _ownerChanges = 0;
+  _contentions = 0;
+#if defined(__linux__)
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_released, NULL);
+  for (uint8_t i = 0; i < BUS_PRIORITIES; i++)
+    _waiting[i] = 0;
+#endif
+}
+
+GP22Bus::~GP22Bus() {
+#if defined(__linux__)
+  pthread_cond_destroy(&_released);
+  pthread_mutex_destroy(&_mutex);
+#endif
+}
+
+#if defined(__linux__)
+
+bool GP22Bus::moreUrgentWaiting(BusPriority priority) {
+  for (uint8_t i = 0; i < priority; i++) {
+    if (_waiting[i] > 0)
+      return true;
+  }
+  return false;
+}
+
+void GP22Bus::acquire(void * owner, BusPriority priority, BusSettingsCallback apply) {
+  pthread_mutex_lock(&_mutex);
+
+  // Nested transactions just go on the one we already have
+  if (_depth > 0 && pthread_equal(_thread, pthread_self())) {
+    _depth++;
+    pthread_mutex_unlock(&_mutex);
+    return;
+  }
+
+  if (_depth > 0 || moreUrgentWaiting(priority)) {
+    _contentions++;
+    _waiting[priority]++;
+    while (_depth > 0 || moreUrgentWaiting(priority))
+      pthread_cond_wait(&_released, &_mutex);
+    _waiting[priority]--;
+  }
+
+  _depth = 1;
+  _thread = pthread_self();
+  _transactions++;
+  bool changed = owner != _owner;
+  if (changed) {
+    _owner = owner;
+    _ownerChanges++;
+  }
+
+  pthread_mutex_unlock(&_mutex);
+
+  // We have the bus now, so the settings can be put back outside the lock
+  if (changed && apply)
+    apply(owner);
+}
+
+void GP22Bus::release() {
+  pthread_mutex_lock(&_mutex);
+  if (_depth > 0) {
+    _depth--;
+    // Everyone has to re-check, as only the most urgent may go next
+    if (_depth == 0)
+      pthread_cond_broadcast(&_released);
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+void GP22Bus::invalidateOwner() {
+  pthread_mutex_lock(&_mutex);
+  _owner = NULL;
+  pthread_mutex_unlock(&_mutex);
+}
+
+#else
+
+void GP22Bus::acquire(void * owner, BusPriority priority, BusSettingsCallback apply) {
+  // Single threaded, so the bus is always free (or already ours).
+  if (_depth++ > 0)
+    return;
+
+  _transactions++;
+  if (owner != _owner) {
+    _owner = owner;
+    _ownerChanges++;
+    if (apply)
+      apply(owner);
+  }
+}
+
+void GP22Bus::release() {
+  if (_depth > 0)
+    _depth--;
+}
+
+void GP22Bus::invalidateOwner() {
+  _owner = NULL;
+}
+
+#endif
+
+void GP22Bus::end() {
+  _transport->end();
+}
+
+GP22Transport * GP22Bus::getTransport() {
+  return _transport;
+}
+
+uint32_t GP22Bus::getTransactionCount() {
+  return _transactions;
+}
+uint32_t GP22Bus::getOwnerChangeCount() {
+  return _ownerChanges;
+}
+uint32_t GP22Bus::getContentionCount() {
+  return _contentions;
+}
@@ -0,0 +1,85 @@
+#ifndef GP22Bus_h
+#define GP22Bus_h
+
+#include "stdint.h"
+#include "stddef.h"
+#include "GP22Transport.h"
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+// Who gets the bus first when several are waiting. Lower is more urgent.
+enum BusPriority: uint8_t {
+  TDC_PRIORITY,    // Result and status reads, measurement opcodes
+  NORMAL_PRIORITY, // Everything else
+  BULK_PRIORITY    // Config writes
+};
+#define BUS_PRIORITIES 3
+
+// Called when a device takes over the bus from another one, so it can put
+// its own settings (clock, mode, bit order, ...) back.
+typedef void (*BusSettingsCallback)(void * owner);
+
+// Shares one SPI bus (controller) between several GP22s (and any other devices).
+// A device holds the bus for a whole transaction, e.g. an opcode and its
+// data bytes, or a batch of them, so frames from different devices never
+// interleave. Holding it is re-entrant for the thread that has it, so
+// batches can be made up of smaller transactions.
+//
+// When the bus is released, the most urgent waiter gets it next, so TDC
+// reads get in between the register writes of a config upload. Settings
+// are only re-applied when the owner changes.
+//
+// On Linux the waiting is done with a pthread mutex and condition. On the
+// Arduino there is nothing to wait for, but the owner tracking (and so
+// settings re-application) still works.
+class GP22Bus
+{
+public:
+  // Each bus is on its own SPI controller, so chips on different buses can
+  // be talked to at the same time.
+  GP22Bus(GP22Transport &transport = gp22DefaultTransport());
+  ~GP22Bus();
+
+  // Shut the controller down. The chips on the bus don't do this themselves
+  // (they'd take it away from each other), so whoever owns the bus should.
+  void end();
+
+  // Wait for the bus and take it. The owner is any pointer that identifies
+  // the device, and apply is called with it if the bus changes hands.
+  void acquire(void * owner, BusPriority priority, BusSettingsCallback apply);
+  // Give the bus back (once per acquire).
+  void release();
+
+  // Make the next acquire re-apply its settings, whoever it is.
+  void invalidateOwner();
+
+  // The SPI controller this bus is on
+  GP22Transport * getTransport();
+
+  // How many times a whole transaction has been started
+  uint32_t getTransactionCount();
+  // How many times the settings have been re-applied
+  uint32_t getOwnerChangeCount();
+  // How many transactions had to wait for another one
+  uint32_t getContentionCount();
+
+private:
+  GP22Transport * _transport;
+  void * _owner;
+  uint8_t _depth;
+  uint32_t _transactions;
+  uint32_t _ownerChanges;
+  uint32_t _contentions;
+
+#if defined(__linux__)
+  bool moreUrgentWaiting(BusPriority priority);
+
+  pthread_mutex_t _mutex;
+  pthread_cond_t _released;
+  pthread_t _thread;
+  uint16_t _waiting[BUS_PRIORITIES];
+#endif
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "GP22Coincidence.h"
+
+GP22Coincidence::GP22Coincidence(uint8_t numSources, GP22CoincidenceCallback callback)
+  : _merge(numSources) {
+  _callback = callback;
+  // Default to a window of one reference clock period
+  _window = (int64_t)1 << 16;
+  _minSources = 2;
+  _groupOpen = false;
+  _groups = 0;
+}
+
+void GP22Coincidence::setWindow(int64_t window) {
+  _window = window;
+}
+int64_t GP22Coincidence::getWindow() {
+  return _window;
+}
+void GP22Coincidence::setMinSources(uint8_t sources) {
+  _minSources = sources;
+}
+uint8_t GP22Coincidence::getMinSources() {
+  return _minSources;
+}
+
+int8_t GP22Coincidence::sourceId(uint8_t chip, Channel channel) {
+  if (chip >= GP22_COINCIDENCE_MAX_CHIPS)
+    return -1;
+  return 2 * chip + (channel == CH2 ? 1 : 0);
+}
+
+bool GP22Coincidence::push(uint8_t source, int64_t time) {
+  bool ok = _merge.push(source, time);
+  process(false);
+  return ok;
+}
+
+int8_t GP22Coincidence::pushHits(uint8_t chip, GP22 &tdc, Channel channel, int64_t armTime,
+    const uint8_t * registers, uint8_t numRegisters) {
+  int8_t source = sourceId(chip, channel);
+  if (source < 0 || source >= _merge.getNumSources())
+    return -1;
+
+  uint8_t hits = tdc.getMeasuredHits(channel);
+  if (hits > numRegisters)
+    hits = numRegisters;
+
+  uint8_t pushed = 0;
+  for (uint8_t i = 0; i < hits; i++) {
+    // There are only 4 result registers
+    if (registers[i] > 3)
+      break;
+    // The merge drops (and counts) hits that don't fit or go backwards
+    if (_merge.push(source, armTime + tdc.readResult(registers[i])))
+      pushed++;
+  }
+
+  process(false);
+  return pushed;
+}
+
+void GP22Coincidence::setActive(uint8_t source, bool active) {
+  _merge.setActive(source, active);
+  process(false);
+}
+
+void GP22Coincidence::flush() {
+  process(true);
+  closeGroup();
+}
+
+void GP22Coincidence::process(bool force) {
+  GP22Event event;
+  while (_merge.pop(event, force))
+    addEvent(event);
+}
+
+void GP22Coincidence::addEvent(const GP22Event &event) {
+  // If the event is outside the window, then the current group is done.
+  if (_groupOpen && (event.time - _group.start) > _window)
+    closeGroup();
+
+  if (!_groupOpen) {
+    _group.start = event.time;
+    _group.numEvents = 0;
+    _group.sourceMask = 0;
+    _groupOpen = true;
+  }
+
+  // Extra events still count towards the sources, they just aren't stored.
+  if (_group.numEvents < GP22_COINCIDENCE_MAX_EVENTS) {
+    _group.events[_group.numEvents] = event;
+    _group.numEvents++;
+  }
+  _group.sourceMask |= (uint32_t)1 << event.source;
+}
+
+void GP22Coincidence::closeGroup() {
+  if (!_groupOpen)
+    return;
+  _groupOpen = false;
+
+  // Count how many different sources were in the group
+  uint8_t sources = 0;
+  for (uint32_t mask = _group.sourceMask; mask > 0; mask &= mask - 1)
+    sources++;
+
+  if (sources >= _minSources) {
+    _groups++;
+    if (_callback)
+      _callback(_group);
+  }
+}
+
+uint32_t GP22Coincidence::getGroupCount() {
+  return _groups;
+}
+uint32_t GP22Coincidence::getDroppedCount() {
+  return _merge.getDroppedCount();
+}
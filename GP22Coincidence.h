@@ -0,0 +1,85 @@
+#ifndef GP22Coincidence_h
+#define GP22Coincidence_h
+
+#include "stdint.h"
+#include "GP22.h"
+#include "GP22Merge.h"
+
+// The most events that are kept for a single coincidence group
+#define GP22_COINCIDENCE_MAX_EVENTS 16
+// Each chip has a source per channel, so this many chips fit in the merge
+#define GP22_COINCIDENCE_MAX_CHIPS (GP22_MERGE_MAX_SOURCES / 2)
+
+// A set of events that all fall within the window of the first one
+struct GP22CoincidenceGroup {
+  int64_t start;
+  uint8_t numEvents;
+  // Bit n is set if source n took part
+  uint32_t sourceMask;
+  GP22Event events[GP22_COINCIDENCE_MAX_EVENTS];
+};
+
+typedef void (*GP22CoincidenceCallback)(const GP22CoincidenceGroup &group);
+
+// A streaming coincidence finder across channels and chips.
+// Each (chip, channel) pair is a source of time ordered hits, which are
+// merged into one stream by time. Events that come within the window of
+// the first event of a group are added to that group, and a group is handed
+// to the callback once it closes if enough separate sources took part.
+//
+// All times should be in raw Q16.16 units on a common timebase, e.g. the
+// time the chip was armed plus its readResult().
+class GP22Coincidence
+{
+public:
+  GP22Coincidence(uint8_t numSources, GP22CoincidenceCallback callback);
+
+  // The window is in the same units as the times
+  void setWindow(int64_t window);
+  int64_t getWindow();
+  // How many different sources are needed to count as a coincidence
+  void setMinSources(uint8_t sources);
+  uint8_t getMinSources();
+
+  // The source number to use for a channel on the n-th chip, or -1 if there
+  // are more chips than GP22_COINCIDENCE_MAX_CHIPS.
+  static int8_t sourceId(uint8_t chip, Channel channel);
+
+  // Add a hit, and process anything that can now be merged.
+  bool push(uint8_t source, int64_t time);
+  // Add a chip's measured hits on a channel. Which result register holds
+  // which hit depends on how the ALU was set up (and on the other channel's
+  // hits, as they share the registers), so registers[n] is the register
+  // with the time of hit n + 1 on this channel. Only as many hits as there
+  // are registers given are read. Call readStatus() first.
+  // Returns how many hits the merge took, or -1 if the chip has no source.
+  int8_t pushHits(uint8_t chip, GP22 &tdc, Channel channel, int64_t armTime,
+    const uint8_t * registers, uint8_t numRegisters);
+
+  // Sources that have stopped should be made inactive so they don't hold
+  // up the merge.
+  void setActive(uint8_t source, bool active);
+
+  // Process everything still queued and close the open group.
+  void flush();
+
+  uint32_t getGroupCount();
+  // How many events didn't fit into the merge queues
+  uint32_t getDroppedCount();
+
+private:
+  void process(bool force);
+  void addEvent(const GP22Event &event);
+  void closeGroup();
+
+  GP22Merge _merge;
+  GP22CoincidenceCallback _callback;
+  int64_t _window;
+  uint8_t _minSources;
+
+  GP22CoincidenceGroup _group;
+  bool _groupOpen;
+  uint32_t _groups;
+};
+
+#endif
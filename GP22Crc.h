@@ -0,0 +1,24 @@
+#ifndef GP22Crc_h
+#define GP22Crc_h
+
+#include "stdint.h"
+#include "stddef.h"
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), used to check anything the
+// library writes out for other tools to read. It is bitwise rather than
+// table driven to keep it out of flash, which is plenty for frame sized data.
+// Pass the last CRC back in to carry on over more data.
+inline uint16_t gp22Crc16(const uint8_t * data, size_t length, uint16_t crc = 0xFFFF) {
+  for (size_t i = 0; i < length; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      if (crc & 0x8000)
+        crc = (crc << 1) ^ 0x1021;
+      else
+        crc <<= 1;
+    }
+  }
+  return crc;
+}
+
+#endif
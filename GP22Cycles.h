@@ -0,0 +1,71 @@
+#ifndef GP22Cycles_h
+#define GP22Cycles_h
+
+#include "stdint.h"
+
+// A cheap, free running cycle counter for timestamping and benchmarking.
+// It wraps around (32 bits), so only use differences.
+//   Cortex-M3/M4 (e.g. the Due): the DWT cycle counter, once gp22CyclesBegin() is called
+//   x86: the time stamp counter
+//   other Linux: nanoseconds from the monotonic clock
+//   anything else: micros()
+// GP22_CYCLES_HZ is how fast it counts, where that is known at compile time
+// (0 otherwise).
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+
+#define GP22_DEMCR (*(volatile uint32_t *)0xE000EDFC)
+#define GP22_DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+#define GP22_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+#ifdef F_CPU
+#define GP22_CYCLES_HZ F_CPU
+#else
+#define GP22_CYCLES_HZ 0
+#endif
+
+inline void gp22CyclesBegin() {
+  // Turn on the trace block, then the counter itself
+  GP22_DEMCR |= 1UL << 24;
+  GP22_DWT_CYCCNT = 0;
+  GP22_DWT_CTRL |= 1;
+}
+inline uint32_t gp22Cycles() {
+  return GP22_DWT_CYCCNT;
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+#include <x86intrin.h>
+#define GP22_CYCLES_HZ 0
+
+inline void gp22CyclesBegin() {}
+inline uint32_t gp22Cycles() {
+  return (uint32_t)__rdtsc();
+}
+
+#elif defined(__linux__)
+
+#include <time.h>
+#define GP22_CYCLES_HZ 1000000000UL
+
+inline void gp22CyclesBegin() {}
+inline uint32_t gp22Cycles() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000000000ULL + now.tv_nsec);
+}
+
+#else
+
+#include "Arduino.h"
+#define GP22_CYCLES_HZ 1000000UL
+
+inline void gp22CyclesBegin() {}
+inline uint32_t gp22Cycles() {
+  return micros();
+}
+
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+#include "GP22Decimator.h"
+
+GP22Decimator::GP22Decimator(uint16_t ratio) {
+  _compensation = true;
+  setRatio(ratio);
+}
+
+void GP22Decimator::setRatio(uint16_t ratio) {
+  _ratio = ratio > 0 ? ratio : 1;
+  _gain = 1;
+  for (uint8_t i = 0; i < GP22_CIC_ORDER; i++)
+    _gain *= _ratio;
+  reset();
+}
+uint16_t GP22Decimator::getRatio() {
+  return _ratio;
+}
+void GP22Decimator::setCompensation(bool on) {
+  _compensation = on;
+}
+
+void GP22Decimator::reset() {
+  _started = false;
+  _reference = 0;
+  _count = 0;
+  for (uint8_t i = 0; i < GP22_CIC_ORDER; i++) {
+    _integrators[i] = 0;
+    _combs[i] = 0;
+  }
+  for (uint8_t i = 0; i < 3; i++)
+    _history[i] = 0;
+  _outputs = 0;
+  _output = 0;
+}
+
+bool GP22Decimator::add(int32_t raw) {
+  if (!_started) {
+    _reference = raw;
+    _started = true;
+  }
+
+  // Integrate at the input rate
+  uint64_t value = (uint64_t)(int64_t)((int64_t)raw - _reference);
+  for (uint8_t i = 0; i < GP22_CIC_ORDER; i++) {
+    _integrators[i] += value;
+    value = _integrators[i];
+  }
+
+  if (++_count < _ratio)
+    return false;
+  _count = 0;
+
+  // Comb at the output rate
+  for (uint8_t i = 0; i < GP22_CIC_ORDER; i++) {
+    uint64_t previous = _combs[i];
+    _combs[i] = value;
+    value -= previous;
+  }
+
+  // Take the gain off, rounding to nearest, to get back to result LSBs
+  int64_t sum = (int64_t)value;
+  int64_t half = (int64_t)(_gain / 2);
+  int64_t cic = (sum >= 0 ? sum + half : sum - half) / (int64_t)_gain;
+
+  _history[2] = _history[1];
+  _history[1] = _history[0];
+  _history[0] = cic;
+  if (_outputs < 255)
+    _outputs++;
+
+  int64_t output = cic;
+  if (_compensation) {
+    // [-1, 10, -1] / 8, rounded
+    int64_t taps = 10 * _history[1] - _history[0] - _history[2];
+    output = (taps >= 0 ? taps + 4 : taps - 4) / 8;
+  }
+  // The compensator overshoots while it starts up, which can go past the
+  // ends of the int32 range for results near them
+  output += _reference;
+  if (output > INT32_MAX)
+    output = INT32_MAX;
+  else if (output < INT32_MIN)
+    output = INT32_MIN;
+  _output = (int32_t)output;
+  return true;
+}
+
+int32_t GP22Decimator::getOutput() {
+  return _output;
+}
+
+bool GP22Decimator::isSettled() {
+  // The combs need a full CIC impulse response, the compensator two more
+  return _outputs > GP22_CIC_ORDER + (_compensation ? 2 : 0);
+}
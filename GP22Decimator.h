@@ -0,0 +1,68 @@
+#ifndef GP22Decimator_h
+#define GP22Decimator_h
+
+#include "stdint.h"
+
+// The CIC filter order
+#define GP22_CIC_ORDER 3
+
+// Brings a high rate stream of raw results down to a low reporting rate,
+// e.g. several kHz down to 1-10 Hz.
+//
+// A 3rd order CIC (cascaded integrator comb) filter does the decimation:
+// three running sums at the input rate and three differences at the output
+// rate, so it is a few additions per result and no buffer of the block.
+// Its sinc^3 response rejects noise and aliases far better than a plain
+// block average (which is a 1st order CIC). The gain of R^3 is divided out
+// once per output. A short FIR at the output rate then flattens the CIC's
+// droop across the passband: [-1, 10, -1] / 8 undoes the -N w^2 / 24 curve
+// of a sinc^N response to second order. It delays the output by one more
+// output sample.
+//
+// Everything is integer. The results are taken relative to the first one,
+// and the integrators wrap around harmlessly, but the averaged deviation
+// from that first result must stay under 2^63 / R^3 (about 9 million LSBs,
+// 140 clock periods, at R = 10000). Timeouts shouldn't be added; add the
+// last good result in their place if the output rate has to be kept.
+class GP22Decimator
+{
+public:
+  // ratio is how many results make one output (at least 1)
+  GP22Decimator(uint16_t ratio);
+
+  void setRatio(uint16_t ratio);
+  uint16_t getRatio();
+  // Turn the droop compensator on (the default) or off
+  void setCompensation(bool on);
+
+  // Start again from the next result
+  void reset();
+
+  // Add a raw result. Returns true when there is a new output.
+  bool add(int32_t raw);
+
+  // The latest output, as a raw Q16.16 result
+  int32_t getOutput();
+  // Whether the filters have had enough outputs to settle (before then the
+  // outputs are still ramping up from the first result)
+  bool isSettled();
+
+private:
+  uint16_t _ratio;
+  bool _compensation;
+
+  bool _started;
+  int32_t _reference;
+  uint16_t _count;
+  // Unsigned, so wrapping around is well defined
+  uint64_t _integrators[GP22_CIC_ORDER];
+  uint64_t _combs[GP22_CIC_ORDER];
+  uint64_t _gain;
+
+  // The last three CIC outputs, for the compensator
+  int64_t _history[3];
+  uint8_t _outputs;
+  int32_t _output;
+};
+
+#endif
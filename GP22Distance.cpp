@@ -0,0 +1,150 @@
+#include "GP22Distance.h"
+
+// How many status reads to wait for the echoes
+#define GP22_DISTANCE_MAX_POLLS 1000
+// After this many readings in a row fall outside the tracking gate,
+// assume the target really has moved and take the first echo.
+#define GP22_DISTANCE_MAX_REJECTS 4
+
+// Speed of sound in dry air, in mm/s, from -40 C to +85 C in 5 C steps.
+// c = 331300 * sqrt(1 + T / 273.15)
+static const uint32_t airSpeedTable[GP22_AIR_TABLE_ENTRIES] = {
+  306083, 309347, 312578, 315775, 318941, 322075, 325179, 328254,
+  331300, 334318, 337310, 340275, 343215, 346129, 349019, 351886,
+  354729, 357550, 360349, 363126, 365882, 368617, 371332, 374028,
+  376704, 379362
+};
+
+GP22Distance::GP22Distance(GP22 &tdc) : _tdc(tdc) {
+  _zeroOffset = 0;
+  _gate = 0;
+  _last = 0;
+  _haveLast = false;
+  _rejectedInARow = 0;
+  setSpeedTable(airSpeedTable, GP22_AIR_TABLE_FIRST, GP22_AIR_TABLE_STEP, GP22_AIR_TABLE_ENTRIES);
+  // Room temperature to start with
+  setTemperature(200);
+}
+
+void GP22Distance::setSpeedTable(const uint32_t * table, int16_t firstDeciC, uint16_t stepDeciC, uint8_t entries) {
+  if (table == NULL || stepDeciC == 0 || entries == 0)
+    return;
+  _table = table;
+  _tableFirst = firstDeciC;
+  _tableStep = stepDeciC;
+  _tableEntries = entries;
+}
+
+void GP22Distance::setTemperature(int16_t deciC) {
+  // Find where we are in the table, clamping at the ends
+  int32_t offset = (int32_t)deciC - _tableFirst;
+  int32_t last = (int32_t)(_tableEntries - 1) * _tableStep;
+  if (offset < 0)
+    offset = 0;
+  if (offset > last)
+    offset = last;
+
+  uint8_t index = offset / _tableStep;
+  int32_t remainder = offset % _tableStep;
+
+  // Linearly interpolate between the entries
+  _speed = _table[index];
+  if (remainder > 0 && index + 1 < _tableEntries) {
+    int32_t slope = (int32_t)_table[index + 1] - (int32_t)_table[index];
+    _speed += (slope * remainder) / _tableStep;
+  }
+
+  updateFactor();
+}
+uint32_t GP22Distance::getSpeedOfSound() {
+  return _speed;
+}
+
+void GP22Distance::updateFactor() {
+  // There and back again, so d = t * c / 2, with t = raw / 2^16 clocks and
+  // a clock of 4 MHz / pre-divider. Keeping 40 fraction bits gives
+  // factor = c * div * 2^23 / 4 MHz.
+  _factor = ((int64_t)_speed * _tdc.getClkPreDiv() << 23) / GP22_REF_CLOCK_HZ;
+}
+
+void GP22Distance::setZeroOffset(int32_t raw) {
+  _zeroOffset = raw;
+}
+
+void GP22Distance::setMinimumRange(uint32_t mm) {
+  // The time for the round trip, in Q14.5 clocks:
+  // 2 * mm / c * 4 MHz / div * 2^5
+  uint64_t delay = ((uint64_t)mm * GP22_REF_CLOCK_HZ * 64) / ((uint64_t)_speed * _tdc.getClkPreDiv());
+  // Don't forget the zero offset, which is a Q16.16 number of clocks.
+  if (_zeroOffset > 0)
+    delay += (uint32_t)_zeroOffset >> 11;
+
+  _tdc.setStopMask(1, (uint32_t)delay);
+  _tdc.updateConfig();
+}
+
+void GP22Distance::setTrackingGate(uint32_t mm) {
+  _gate = mm;
+}
+
+int32_t GP22Distance::toMillimetres(int32_t raw) {
+  // Add a half before shifting to round to the nearest mm
+  int64_t scaled = (int64_t)(raw - _zeroOffset) * _factor + ((int64_t)1 << (GP22_DISTANCE_SHIFT - 1));
+  return (int32_t)(scaled >> GP22_DISTANCE_SHIFT);
+}
+
+bool GP22Distance::process(const int32_t * echoes, uint8_t count, int32_t &mm) {
+  if (count == 0)
+    return false;
+
+  // Without tracking (or anything to track) the first echo is the one
+  if (_gate == 0 || !_haveLast) {
+    _last = toMillimetres(echoes[0]);
+  } else {
+    bool found = false;
+    for (uint8_t i = 0; i < count; i++) {
+      int32_t distance = toMillimetres(echoes[i]);
+      int32_t difference = distance - _last;
+      if (difference < 0)
+        difference = -difference;
+      if ((uint32_t)difference <= _gate) {
+        _last = distance;
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      _rejectedInARow++;
+      if (_rejectedInARow < GP22_DISTANCE_MAX_REJECTS)
+        return false;
+      // It has moved for real, start tracking from the first echo
+      _last = toMillimetres(echoes[0]);
+    }
+  }
+
+  _rejectedInARow = 0;
+  _haveLast = true;
+  mm = _last;
+  return true;
+}
+
+bool GP22Distance::measure(int32_t &mm) {
+  _tdc.measure();
+  if (!_tdc.waitForResult(GP22_DISTANCE_MAX_POLLS))
+    return false;
+
+  uint8_t count = _tdc.getMeasuredHits(CH1);
+  // There are only 4 result registers
+  if (count > 4)
+    count = 4;
+  int32_t echoes[4];
+  for (uint8_t i = 0; i < count; i++)
+    echoes[i] = _tdc.readResult(i);
+
+  return process(echoes, count, mm);
+}
+
+int32_t GP22Distance::getLastDistance() {
+  return _last;
+}
@@ -0,0 +1,79 @@
+#ifndef GP22Distance_h
+#define GP22Distance_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// The speed of sound table for air that is used by default
+#define GP22_AIR_TABLE_FIRST -400
+#define GP22_AIR_TABLE_STEP 50
+#define GP22_AIR_TABLE_ENTRIES 26
+// Fraction bits of the precalculated raw to distance factor
+#define GP22_DISTANCE_SHIFT 40
+
+// Single direction (echo) TOF to distance, for level measurement.
+// The speed of sound comes from a precomputed table indexed by temperature
+// (air, -40 to +85 C, by default), and is folded together with the clock
+// settings into a single factor, so each sample is one multiply and shift.
+// Everything is integer arithmetic, with the distance in millimetres.
+//
+// The transducer ringdown is masked off on the chip itself with the stop
+// masking, and when there are several echoes the one that fits with the
+// last reading is picked.
+class GP22Distance
+{
+public:
+  GP22Distance(GP22 &tdc);
+
+  // Use a different speed of sound table, e.g. for water. The table is in
+  // mm/s at evenly spaced temperatures, in tenths of a degree C.
+  void setSpeedTable(const uint32_t * table, int16_t firstDeciC, uint16_t stepDeciC, uint8_t entries);
+  // Set the temperature of the medium, in tenths of a degree C.
+  // This works out the speed of sound, so it is not for every sample.
+  void setTemperature(int16_t deciC);
+  // The current speed of sound, in mm/s
+  uint32_t getSpeedOfSound();
+
+  // The raw result when the target is at zero distance (the electronics
+  // and transducer delays).
+  void setZeroOffset(int32_t raw);
+
+  // Mask the stops for anything closer than this (at the current speed of
+  // sound) and write the config to the chip.
+  void setMinimumRange(uint32_t mm);
+
+  // Echoes further than this from the last reading are passed over in
+  // favour of a later echo. 0 turns the tracking off.
+  void setTrackingGate(uint32_t mm);
+
+  // Convert a raw result into a distance in mm.
+  int32_t toMillimetres(int32_t raw);
+  // Pick the right echo out of a set of raw results (in time order), and
+  // give its distance. Returns false if there were none.
+  bool process(const int32_t * echoes, uint8_t count, int32_t &mm);
+  // Run a measurement and process the echoes. This assumes the ALU has been
+  // set up to leave one result per hit, in order, in the result registers.
+  bool measure(int32_t &mm);
+
+  int32_t getLastDistance();
+
+private:
+  void updateFactor();
+
+  GP22 &_tdc;
+  const uint32_t * _table;
+  int16_t _tableFirst;
+  uint16_t _tableStep;
+  uint8_t _tableEntries;
+
+  uint32_t _speed;
+  int32_t _zeroOffset;
+  int64_t _factor;
+
+  uint32_t _gate;
+  int32_t _last;
+  bool _haveLast;
+  uint8_t _rejectedInARow;
+};
+
+#endif
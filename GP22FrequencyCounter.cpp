@@ -0,0 +1,67 @@
+#include "GP22FrequencyCounter.h"
+
+// How many status reads to wait for a reading
+#define GP22_FREQ_MAX_POLLS 1000
+
+GP22FrequencyCounter::GP22FrequencyCounter(GP22 &tdc) : _tdc(tdc) {
+  _periods = 0;
+  _numerator = 0;
+  _lastRaw = 0;
+}
+
+bool GP22FrequencyCounter::configure(uint8_t periods) {
+  if (_tdc.getMeasurementMode() == 2) {
+    // In MM2 the start is the first hit on channel 1 (operator 1), the stops
+    // follow as operators 2, 3 and 4, and the ALU does HIT2 - HIT1.
+    if (periods < 1 || periods > 3)
+      return false;
+    _tdc.setExpectedHits(CH1, periods + 1);
+    _tdc.defineHit1Op(1);
+    _tdc.defineHit2Op(1 + periods);
+  } else {
+    // In MM1 the start is operator 0, the stops on channel 1 are 1-4,
+    // and the ALU does HIT1 - HIT2.
+    if (periods < 1 || periods > 4)
+      return false;
+    _tdc.setExpectedHits(CH1, periods);
+    _tdc.defineHit1Op(periods);
+    _tdc.defineHit2Op(0);
+  }
+  _tdc.setExpectedHits(CH2, 0);
+  _tdc.updateConfig();
+
+  _periods = periods;
+
+  // f = N / T, with T = raw / 2^16 clocks and the clock = 4 MHz / pre-divider.
+  // So f in Q40.24 is N * 4 MHz * 2^(16 + 24) / (pre-divider * raw).
+  // With N <= 4 this just fits in 64 bits.
+  _numerator = ((uint64_t)periods * GP22_REF_CLOCK_HZ << (16 + GP22_FREQ_FRACTION_BITS)) / _tdc.getClkPreDiv();
+
+  return true;
+}
+uint8_t GP22FrequencyCounter::getPeriods() {
+  return _periods;
+}
+
+bool GP22FrequencyCounter::read(uint64_t &frequency) {
+  _tdc.measure();
+  if (!_tdc.waitForResult(GP22_FREQ_MAX_POLLS))
+    return false;
+
+  _lastRaw = _tdc.readResult(0);
+  if (_lastRaw <= 0)
+    return false;
+
+  frequency = convert(_lastRaw);
+  return true;
+}
+
+uint64_t GP22FrequencyCounter::convert(int32_t raw) {
+  if (raw <= 0)
+    return 0;
+  return _numerator / (uint32_t)raw;
+}
+
+int32_t GP22FrequencyCounter::getLastRaw() {
+  return _lastRaw;
+}
@@ -0,0 +1,43 @@
+#ifndef GP22FrequencyCounter_h
+#define GP22FrequencyCounter_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// The frequency is returned as unsigned Q40.24 Hz
+#define GP22_FREQ_FRACTION_BITS 24
+
+// A reciprocal frequency counter built on the TDC.
+// The signal goes to both START and STOP1, and the ALU measures the time
+// from the start to the N-th stop edge, so each reading covers N periods.
+// The frequency is then N / T, worked out with a single precalculated 64 bit
+// numerator and one integer divide per reading (no floating point).
+class GP22FrequencyCounter
+{
+public:
+  GP22FrequencyCounter(GP22 &tdc);
+
+  // Set up the hits and ALU operators to measure over the given number of
+  // periods, and write the config to the GP22. In measurement mode 1 this
+  // can be 1-4 periods, in mode 2 it can be 1-3 (the start takes a hit).
+  // Call this after setting the measurement mode and clock pre-divider.
+  bool configure(uint8_t periods);
+  uint8_t getPeriods();
+
+  // Do a single measurement, giving the frequency in Q40.24 Hz.
+  // Returns false on a timeout or an impossible result.
+  bool read(uint64_t &frequency);
+  // Work out the frequency from a raw result that has already been read.
+  uint64_t convert(int32_t raw);
+
+  // The raw result of the last reading (N periods, in Q16.16 clocks)
+  int32_t getLastRaw();
+
+private:
+  GP22 &_tdc;
+  uint8_t _periods;
+  uint64_t _numerator;
+  int32_t _lastRaw;
+};
+
+#endif
@@ -0,0 +1,219 @@
+#include "GP22HeatMeter.h"
+
+// How many status reads to wait for a measurement
+#define GP22_HEAT_MAX_POLLS 1000
+// Gaps longer than this (in microseconds) are not integrated over
+#define GP22_HEAT_MAX_STEP 1000000UL
+#define GP22_NANO_PER_JOULE 1000000000UL
+
+GP22HeatMeter::GP22HeatMeter(GP22 &tdc, GP22DirectionCallback direction) : _tdc(tdc) {
+  _direction = direction;
+
+  _temperatureRatio = 16;
+  _cyclesSinceTemperature = 0;
+  _haveTemperature = false;
+
+  _flowCoefficient = 0;
+  _flowZero = 0;
+  _heatCoefficient = 4180;
+  setTemperaturePorts(0, 1, 2);
+  setResistances(1000, 1000);
+
+  _flow = 0;
+  _deltaT = 0;
+  _power = 0;
+  _lastIntegration = 0;
+  _integrating = false;
+  _joules = 0;
+  _nanoJoules = 0;
+
+  _integrationPeriod = 1000000;
+  _periodStart = micros();
+  _periodSpiStart = _tdc.getSpiByteCount();
+  _current = GP22HeatMeterBudget();
+  _budget = GP22HeatMeterBudget();
+}
+
+void GP22HeatMeter::setTemperatureRatio(uint16_t n) {
+  _temperatureRatio = n > 0 ? n : 1;
+}
+uint16_t GP22HeatMeter::getTemperatureRatio() {
+  return _temperatureRatio;
+}
+
+void GP22HeatMeter::setFlowCoefficient(int32_t coefficient) {
+  _flowCoefficient = coefficient;
+}
+void GP22HeatMeter::setFlowZero(int32_t raw) {
+  _flowZero = raw;
+}
+void GP22HeatMeter::setHeatCoefficient(uint16_t coefficient) {
+  _heatCoefficient = coefficient;
+}
+void GP22HeatMeter::setTemperaturePorts(uint8_t reference, uint8_t forward, uint8_t ret) {
+  // There are only 4 result registers
+  if (reference < 4 && forward < 4 && ret < 4) {
+    _referencePort = reference;
+    _forwardPort = forward;
+    _returnPort = ret;
+  }
+}
+void GP22HeatMeter::setResistances(uint32_t referenceOhms, uint32_t sensorOhmsAt0C) {
+  if (sensorOhmsAt0C == 0)
+    return;
+  // The discharge times are proportional to the resistances, so
+  // dT = (t_fwd - t_ret) / t_ref * R_ref / (R0 * 0.00385).
+  // Precalculate everything but the times, in millikelvin.
+  _temperatureCoefficient = (uint32_t)(((uint64_t)referenceOhms * 1000000000ULL) / ((uint64_t)sensorOhmsAt0C * 3850));
+}
+
+void GP22HeatMeter::setIntegrationPeriod(uint32_t micros) {
+  _integrationPeriod = micros;
+}
+
+bool GP22HeatMeter::step() {
+  uint32_t start = micros();
+  bool ok;
+
+  // We need a temperature before any energy can be worked out
+  if (!_haveTemperature || _cyclesSinceTemperature >= _temperatureRatio) {
+    ok = temperatureCycle();
+    _cyclesSinceTemperature = 0;
+    _current.temperatureCycles++;
+  } else {
+    ok = tofCycle();
+    _cyclesSinceTemperature++;
+    _current.tofCycles++;
+    if (ok)
+      integrate(start);
+  }
+  if (!ok)
+    _current.failedCycles++;
+
+  uint32_t end = micros();
+  _current.cpuMicros += end - start;
+
+  // Close off the budget period if it is done
+  if (end - _periodStart >= _integrationPeriod) {
+    uint32_t spiBytes = _tdc.getSpiByteCount();
+    _current.periodMicros = end - _periodStart;
+    _current.spiBytes = spiBytes - _periodSpiStart;
+    _budget = _current;
+
+    _current = GP22HeatMeterBudget();
+    _periodStart = end;
+    _periodSpiStart = spiBytes;
+  }
+
+  return ok;
+}
+
+bool GP22HeatMeter::shot(int32_t &result) {
+  _tdc.measure();
+  if (!_tdc.waitForResult(GP22_HEAT_MAX_POLLS))
+    return false;
+  result = _tdc.readResult(0);
+  return true;
+}
+
+bool GP22HeatMeter::tofCycle() {
+  int32_t up;
+  int32_t down;
+
+  if (_direction)
+    _direction(true);
+  if (!shot(up))
+    return false;
+  if (_direction)
+    _direction(false);
+  if (!shot(down))
+    return false;
+
+  int64_t difference = (int64_t)up - down - _flowZero;
+  _flow = (int32_t)((difference * _flowCoefficient) >> 16);
+  // L/s (Q16.16) * mK * J/(L K) = mW, once the Q16 is shifted off
+  _power = ((int64_t)_flow * _deltaT * _heatCoefficient) >> 16;
+
+  return true;
+}
+
+bool GP22HeatMeter::temperatureCycle() {
+  uint8_t lastPort = _referencePort;
+  if (_forwardPort > lastPort)
+    lastPort = _forwardPort;
+  if (_returnPort > lastPort)
+    lastPort = _returnPort;
+
+  _tdc.measureTemperature();
+
+  // Wait for all the ports we need to have been measured
+  bool done = false;
+  for (uint16_t i = 0; i < GP22_HEAT_MAX_POLLS; i++) {
+    _tdc.readStatus();
+    if (_tdc.timedOut())
+      break;
+    if (_tdc.getReadPointer() > lastPort) {
+      done = true;
+      break;
+    }
+  }
+  if (!done)
+    return false;
+
+  int32_t reference = _tdc.readResult(_referencePort);
+  int32_t forward = _tdc.readResult(_forwardPort);
+  int32_t ret = _tdc.readResult(_returnPort);
+  if (reference <= 0)
+    return false;
+
+  _deltaT = (int32_t)(((int64_t)(forward - ret) * _temperatureCoefficient) / reference);
+  _haveTemperature = true;
+
+  return true;
+}
+
+void GP22HeatMeter::integrate(uint32_t now) {
+  if (!_integrating) {
+    _lastIntegration = now;
+    _integrating = true;
+    return;
+  }
+
+  uint32_t dt = now - _lastIntegration;
+  _lastIntegration = now;
+
+  if (_power <= 0)
+    return;
+  if (dt > GP22_HEAT_MAX_STEP)
+    dt = GP22_HEAT_MAX_STEP;
+
+  // mW * us = nJ. Split off the whole joules before adding up, so the
+  // remainder stays under a joule.
+  uint64_t energy = (uint64_t)_power * dt;
+  _joules += energy / GP22_NANO_PER_JOULE;
+  _nanoJoules += energy % GP22_NANO_PER_JOULE;
+  if (_nanoJoules >= GP22_NANO_PER_JOULE) {
+    _nanoJoules -= GP22_NANO_PER_JOULE;
+    _joules++;
+  }
+}
+
+uint64_t GP22HeatMeter::getEnergyJoules() {
+  return _joules;
+}
+uint32_t GP22HeatMeter::getEnergyNanoJoules() {
+  return _nanoJoules;
+}
+int32_t GP22HeatMeter::getFlow() {
+  return _flow;
+}
+int32_t GP22HeatMeter::getTemperatureDifference() {
+  return _deltaT;
+}
+int64_t GP22HeatMeter::getPower() {
+  return _power;
+}
+
+GP22HeatMeterBudget GP22HeatMeter::getBudget() {
+  return _budget;
+}
@@ -0,0 +1,108 @@
+#ifndef GP22HeatMeter_h
+#define GP22HeatMeter_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// Switch the transducers over for upstream (up = true) or downstream shots
+typedef void (*GP22DirectionCallback)(bool up);
+
+// The CPU and SPI cost of the last full integration period
+struct GP22HeatMeterBudget {
+  uint32_t periodMicros;
+  uint16_t tofCycles;
+  uint16_t temperatureCycles;
+  uint16_t failedCycles;
+  uint32_t spiBytes;
+  uint32_t cpuMicros;
+};
+
+// Heat meter energy integration on a single GP22.
+// Every call to step() runs one cycle on the chip: mostly time of flight
+// cycles (an upstream and a downstream shot) for the flow, with a
+// temperature cycle every so often for the forward/return difference.
+//
+// Power is flow * temperature difference * heat coefficient, in integer mW,
+// and is integrated into whole joules plus a nanojoule remainder, so the
+// total can't overflow in the life of the meter. Only heat delivered
+// (positive power) is counted.
+//
+// The temperature difference uses the linear PT sensor model
+// R = R0 * (1 + 0.00385 * T), which is plenty for a difference.
+class GP22HeatMeter
+{
+public:
+  GP22HeatMeter(GP22 &tdc, GP22DirectionCallback direction);
+
+  // Do a temperature cycle every n TOF cycles
+  void setTemperatureRatio(uint16_t n);
+  uint16_t getTemperatureRatio();
+
+  // The flow in Q16.16 litres per second for one clock period (Q16.16) of
+  // upstream minus downstream TOF.
+  void setFlowCoefficient(int32_t coefficient);
+  // The TOF difference that reads as zero flow
+  void setFlowZero(int32_t raw);
+  // The heat coefficient of the medium, in J/(L K) (about 4180 for water)
+  void setHeatCoefficient(uint16_t coefficient);
+  // Which temperature result registers have the reference resistor and the
+  // forward and return sensors, and the resistances in ohms.
+  void setTemperaturePorts(uint8_t reference, uint8_t forward, uint8_t ret);
+  void setResistances(uint32_t referenceOhms, uint32_t sensorOhmsAt0C);
+
+  // How long each budget period is, in microseconds
+  void setIntegrationPeriod(uint32_t micros);
+
+  // Run the next cycle. Returns false if the cycle failed.
+  bool step();
+
+  // The energy so far, in whole joules
+  uint64_t getEnergyJoules();
+  // The part of a joule not yet in getEnergyJoules()
+  uint32_t getEnergyNanoJoules();
+  // The last flow, in Q16.16 litres per second
+  int32_t getFlow();
+  // The last temperature difference, in millikelvin
+  int32_t getTemperatureDifference();
+  // The last power, in milliwatts
+  int64_t getPower();
+
+  GP22HeatMeterBudget getBudget();
+
+private:
+  bool tofCycle();
+  bool temperatureCycle();
+  bool shot(int32_t &result);
+  void integrate(uint32_t now);
+
+  GP22 &_tdc;
+  GP22DirectionCallback _direction;
+
+  uint16_t _temperatureRatio;
+  uint16_t _cyclesSinceTemperature;
+  bool _haveTemperature;
+
+  int32_t _flowCoefficient;
+  int32_t _flowZero;
+  uint16_t _heatCoefficient;
+  uint8_t _referencePort;
+  uint8_t _forwardPort;
+  uint8_t _returnPort;
+  uint32_t _temperatureCoefficient;
+
+  int32_t _flow;
+  int32_t _deltaT;
+  int64_t _power;
+  uint32_t _lastIntegration;
+  bool _integrating;
+  uint64_t _joules;
+  uint32_t _nanoJoules;
+
+  uint32_t _integrationPeriod;
+  uint32_t _periodStart;
+  uint32_t _periodSpiStart;
+  GP22HeatMeterBudget _current;
+  GP22HeatMeterBudget _budget;
+};
+
+#endif
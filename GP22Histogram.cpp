@@ -0,0 +1,95 @@
+#include "GP22Histogram.h"
+
+// Write a LEB128 varint, returns the new position or 0 if it didn't fit.
+static uint16_t putVarint(uint8_t * buffer, uint16_t pos, uint16_t size, uint32_t value) {
+  do {
+    if (pos >= size)
+      return 0;
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    if (value > 0)
+      byte |= 0x80;
+    buffer[pos++] = byte;
+  } while (value > 0);
+  return pos;
+}
+
+GP22Histogram::GP22Histogram(uint32_t * bins, uint16_t numBins) {
+  _bins = bins;
+  _numBins = numBins;
+  // Default to one bin per reference clock period
+  _shift = 16;
+  _offset = 0;
+  clear();
+}
+
+void GP22Histogram::clear() {
+  for (uint16_t i = 0; i < _numBins; i++)
+    _bins[i] = 0;
+  _outside = 0;
+}
+
+void GP22Histogram::setBinWidthShift(uint8_t shift) {
+  // Shifting a 32 bit number by 32 or more is undefined
+  if (shift < 32)
+    _shift = shift;
+}
+uint8_t GP22Histogram::getBinWidthShift() {
+  return _shift;
+}
+void GP22Histogram::setOffset(int32_t offset) {
+  _offset = offset;
+}
+int32_t GP22Histogram::getOffset() {
+  return _offset;
+}
+
+uint32_t GP22Histogram::getBin(uint16_t bin) {
+  if (bin < _numBins)
+    return _bins[bin];
+  else
+    return 0;
+}
+uint16_t GP22Histogram::getNumBins() {
+  return _numBins;
+}
+uint32_t GP22Histogram::getOutsideCount() {
+  return _outside;
+}
+uint32_t GP22Histogram::getTotalCount() {
+  uint32_t total = _outside;
+  for (uint16_t i = 0; i < _numBins; i++)
+    total += _bins[i];
+  return total;
+}
+
+uint16_t GP22Histogram::exportCompact(uint8_t * buffer, uint16_t size) {
+  uint16_t pos = 0;
+  // Zigzag the offset so small negative numbers stay small
+  uint32_t offset = ((uint32_t)_offset << 1) ^ (uint32_t)(_offset >> 31);
+
+  if ((pos = putVarint(buffer, pos, size, _numBins)) == 0)
+    return 0;
+  if ((pos = putVarint(buffer, pos, size, _shift)) == 0)
+    return 0;
+  if ((pos = putVarint(buffer, pos, size, offset)) == 0)
+    return 0;
+  if ((pos = putVarint(buffer, pos, size, _outside)) == 0)
+    return 0;
+
+  // Only write out the bins that have something in them
+  uint16_t skipped = 0;
+  for (uint16_t i = 0; i < _numBins; i++) {
+    if (_bins[i] == 0) {
+      skipped++;
+      continue;
+    }
+    if ((pos = putVarint(buffer, pos, size, skipped)) == 0)
+      return 0;
+    if ((pos = putVarint(buffer, pos, size, _bins[i])) == 0)
+      return 0;
+    skipped = 0;
+  }
+
+  return pos;
+}
@@ -0,0 +1,57 @@
+#ifndef GP22Histogram_h
+#define GP22Histogram_h
+
+#include "stdint.h"
+
+// A TCSPC style arrival time histogram of raw results.
+// The counters are supplied by the caller, so the memory used is fixed no
+// matter how many samples are taken. A result lands in bin
+// (raw - offset) >> widthShift, anything outside the bins is only counted.
+class GP22Histogram
+{
+public:
+  GP22Histogram(uint32_t * bins, uint16_t numBins);
+
+  // Zero all the counters.
+  void clear();
+
+  // The bin width is 2^shift raw LSBs (so 16 is one reference clock period).
+  void setBinWidthShift(uint8_t shift);
+  uint8_t getBinWidthShift();
+  // The raw result that maps to the start of bin 0.
+  void setOffset(int32_t offset);
+  int32_t getOffset();
+
+  // Bin a raw result. This is inline as it is in the per sample path,
+  // it costs one subtract, shift, compare and increment.
+  void add(int32_t raw) {
+    uint32_t bin = ((uint32_t)raw - (uint32_t)_offset) >> _shift;
+    if (bin < _numBins)
+      _bins[bin]++;
+    else
+      _outside++;
+  }
+
+  uint32_t getBin(uint16_t bin);
+  uint16_t getNumBins();
+  // How many results fell outside of the histogram range
+  uint32_t getOutsideCount();
+  // The total number of results added
+  uint32_t getTotalCount();
+
+  // Write the histogram into a buffer in a compact form. Returns the number
+  // of bytes used, or 0 if the buffer was too small. All numbers are LEB128
+  // varints (with the offset zigzag encoded) laid out as:
+  //   numBins, shift, offset, outside count, then for every non-empty bin
+  //   the number of empty bins skipped before it and its count.
+  uint16_t exportCompact(uint8_t * buffer, uint16_t size);
+
+private:
+  uint32_t * _bins;
+  uint16_t _numBins;
+  uint8_t _shift;
+  int32_t _offset;
+  uint32_t _outside;
+};
+
+#endif
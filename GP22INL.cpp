@@ -0,0 +1,76 @@
+#include "GP22INL.h"
+
+// How many status reads to wait for a calibration result
+#define GP22_INL_MAX_POLLS 1000
+
+GP22INL::GP22INL() {
+  clear();
+}
+
+void GP22INL::clear() {
+  for (uint8_t i = 0; i < GP22_INL_BINS; i++) {
+    _histogram[i] = 0;
+    _table[i] = 0;
+  }
+  _samples = 0;
+}
+
+void GP22INL::addSample(int32_t raw) {
+  _histogram[(raw & 0xFFFF) >> GP22_INL_BIN_SHIFT]++;
+  _samples++;
+}
+uint32_t GP22INL::getSampleCount() {
+  return _samples;
+}
+
+uint16_t GP22INL::collect(GP22 &tdc, uint16_t samples, uint8_t resultRegister) {
+  uint16_t collected = 0;
+
+  for (uint16_t i = 0; i < samples; i++) {
+    tdc.measure();
+    // Timeouts don't tell us anything about the code density, skip them.
+    if (tdc.waitForResult(GP22_INL_MAX_POLLS)) {
+      addSample(tdc.readResult(resultRegister));
+      collected++;
+    }
+  }
+
+  return collected;
+}
+
+bool GP22INL::build(uint32_t minSamples) {
+  if (_samples == 0 || _samples < minSamples)
+    return false;
+
+  // The width of each ideal bin in fine code LSBs
+  const int32_t binWidth = (int32_t)1 << GP22_INL_BIN_SHIFT;
+  uint64_t cumulative = 0;
+  int16_t table[GP22_INL_BINS];
+
+  for (uint8_t i = 0; i < GP22_INL_BINS; i++) {
+    // The true centre of this bin is where the middle of its counts
+    // falls in the cumulative distribution, scaled to 16 bits.
+    uint64_t centreCounts = 2 * cumulative + _histogram[i];
+    int32_t actual = (int32_t)((centreCounts << 15) / _samples);
+    int32_t ideal = i * binWidth + binWidth / 2;
+
+    int32_t error = actual - ideal;
+    if (error > INT16_MAX || error < INT16_MIN)
+      return false;
+    table[i] = (int16_t)error;
+    cumulative += _histogram[i];
+  }
+
+  for (uint8_t i = 0; i < GP22_INL_BINS; i++)
+    _table[i] = table[i];
+  return true;
+}
+
+void GP22INL::getTable(int16_t * arrayToFill) {
+  for (uint8_t i = 0; i < GP22_INL_BINS; i++)
+    arrayToFill[i] = _table[i];
+}
+void GP22INL::setTable(const int16_t * table) {
+  for (uint8_t i = 0; i < GP22_INL_BINS; i++)
+    _table[i] = table[i];
+}
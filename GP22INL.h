@@ -0,0 +1,57 @@
+#ifndef GP22INL_h
+#define GP22INL_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// The fine code is the fractional (bottom 16) bits of a Q16.16 result.
+// It is split into 2^GP22_INL_BIN_BITS bins for the correction table.
+#define GP22_INL_BIN_BITS 6
+#define GP22_INL_BINS (1 << GP22_INL_BIN_BITS)
+#define GP22_INL_BIN_SHIFT (16 - GP22_INL_BIN_BITS)
+
+// Integral nonlinearity correction via a code density test.
+// With start/stop events that are uncorrelated to the reference clock,
+// the fine code of the results should be uniformly distributed. Any
+// deviation from that is the delay line nonlinearity, so a histogram of
+// the fine codes gives the true position of every code bin.
+class GP22INL
+{
+public:
+  GP22INL();
+
+  // Throw away the histogram and go back to an identity table.
+  void clear();
+
+  // Add a raw result to the code density histogram.
+  void addSample(int32_t raw);
+  uint32_t getSampleCount();
+
+  // Run measurements on the TDC and add the results to the histogram.
+  // The inputs must be uncorrelated to the reference clock for this to work.
+  // Returns the number of samples that were actually collected.
+  uint16_t collect(GP22 &tdc, uint16_t samples, uint8_t resultRegister);
+
+  // Build the correction table from the histogram. Fails (and leaves the
+  // table as it was) if there are fewer than minSamples in the histogram,
+  // or if a bin is out by more than an int16_t can correct (a stuck code
+  // or a source that isn't uniform, so the histogram can't be trusted).
+  bool build(uint32_t minSamples);
+
+  // Correct a raw result, do this before measConv().
+  // This is inline as it sits in the per sample path.
+  int32_t correct(int32_t raw) {
+    return raw + _table[(raw & 0xFFFF) >> GP22_INL_BIN_SHIFT];
+  }
+
+  // Direct access to the table, for storing and restoring calibrations.
+  void getTable(int16_t * arrayToFill);
+  void setTable(const int16_t * table);
+
+private:
+  uint32_t _histogram[GP22_INL_BINS];
+  uint32_t _samples;
+  int16_t _table[GP22_INL_BINS];
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "GP22Kalman.h"
+
+// The covariances are clamped to this so that the Q16 gain calculation
+// (which shifts them up by 16 bits) can never overflow.
+#define GP22_KALMAN_MAX_COV ((int64_t)1 << 46)
+// The innovation and the velocity gain are saturated to this, so that
+// squaring the innovation and multiplying it by a gain stay within 64 bits.
+#define GP22_KALMAN_MAX_TERM ((int64_t)INT32_MAX)
+
+static int64_t saturate(int64_t value, int64_t limit) {
+  if (value > limit)
+    return limit;
+  if (value < -limit)
+    return -limit;
+  return value;
+}
+
+GP22Kalman::GP22Kalman(uint32_t processNoise, uint32_t measurementNoise) {
+  _q = processNoise;
+  // A zero measurement noise would make the gain calculation divide by zero.
+  _r = measurementNoise > 0 ? measurementNoise : 1;
+  _gate = 0;
+  reset();
+}
+
+void GP22Kalman::reset() {
+  _x = 0;
+  _v = 0;
+  _p00 = 0;
+  _p01 = 0;
+  _p11 = 0;
+  _initialised = false;
+  _innovation = 0;
+  _innovationVariance = 0;
+  _rejected = 0;
+}
+
+void GP22Kalman::predict() {
+  // State transition is x += v, with a white noise acceleration model.
+  // For a unit time step, Q = q * [1/4 1/2; 1/2 1].
+  _x = (int32_t)saturate((int64_t)_x + _v, GP22_KALMAN_MAX_TERM);
+
+  _p00 += 2 * _p01 + _p11 + (_q >> 2);
+  _p01 += _p11 + (_q >> 1);
+  _p11 += _q;
+
+  // Keep things bounded if we go a long time without accepting a sample.
+  if (_p00 > GP22_KALMAN_MAX_COV)
+    _p00 = GP22_KALMAN_MAX_COV;
+  if (_p11 > GP22_KALMAN_MAX_COV)
+    _p11 = GP22_KALMAN_MAX_COV;
+  if (_p01 > GP22_KALMAN_MAX_COV)
+    _p01 = GP22_KALMAN_MAX_COV;
+  else if (_p01 < -GP22_KALMAN_MAX_COV)
+    _p01 = -GP22_KALMAN_MAX_COV;
+}
+
+bool GP22Kalman::update(int32_t measurement) {
+  if (!_initialised) {
+    // Start at the first measurement with no velocity. The velocity is
+    // completely unknown, so give it the same uncertainty as a shot.
+    _x = measurement;
+    _v = 0;
+    _p00 = _r;
+    _p01 = 0;
+    _p11 = _r;
+    _innovation = 0;
+    _innovationVariance = _r;
+    _initialised = true;
+    return true;
+  }
+
+  predict();
+
+  // A wild measurement can be a 33 bit difference, so saturate it
+  int64_t y = saturate((int64_t)measurement - _x, GP22_KALMAN_MAX_TERM);
+  int64_t s = _p00 + _r;
+
+  _innovation = (int32_t)y;
+  _innovationVariance = s;
+
+  // Gate the sample, comparing y^2 > gate^2 * S to avoid the square root.
+  if (_gate > 0) {
+    uint64_t ySq = (uint64_t)y * (uint64_t)y;
+    uint64_t gateSq = (uint64_t)_gate * _gate;
+    // If gate^2 * S would overflow, then nothing could be outside the gate.
+    if ((uint64_t)s <= (UINT64_MAX / gateSq) && ySq > gateSq * (uint64_t)s) {
+      _rejected++;
+      return false;
+    }
+  }
+
+  // The Kalman gains in Q0.16. P00 < S so k0 < 1, but P01 isn't bounded by
+  // S, and a velocity gain that big is meaningless anyway.
+  int64_t k0 = (_p00 << 16) / s;
+  int64_t k1 = saturate((_p01 << 16) / s, GP22_KALMAN_MAX_TERM);
+
+  _x += (int32_t)((k0 * y) >> 16);
+  _v = (int32_t)saturate(_v + ((k1 * y) >> 16), GP22_KALMAN_MAX_TERM);
+
+  // P = (I - K H) P, using the old values of P00 and P01 throughout.
+  int64_t p00 = _p00;
+  int64_t p01 = _p01;
+  _p00 = p00 - ((k0 * p00) >> 16);
+  _p01 = p01 - ((k0 * p01) >> 16);
+  _p11 = _p11 - ((k1 * p01) >> 16);
+
+  return true;
+}
+
+void GP22Kalman::setGate(uint8_t sigmas) {
+  _gate = sigmas;
+}
+uint8_t GP22Kalman::getGate() {
+  return _gate;
+}
+
+void GP22Kalman::setProcessNoise(uint32_t processNoise) {
+  _q = processNoise;
+}
+void GP22Kalman::setMeasurementNoise(uint32_t measurementNoise) {
+  _r = measurementNoise > 0 ? measurementNoise : 1;
+}
+
+void GP22Kalman::getState(GP22KalmanState &state) {
+  state.x = _x;
+  state.v = _v;
+  state.p00 = _p00;
+  state.p01 = _p01;
+  state.p11 = _p11;
+  state.initialised = _initialised;
+}
+void GP22Kalman::setState(const GP22KalmanState &state) {
+  _x = state.x;
+  _v = state.v;
+  _p00 = state.p00;
+  _p01 = state.p01;
+  _p11 = state.p11;
+  _initialised = state.initialised;
+}
+
+int32_t GP22Kalman::getEstimate() {
+  return _x;
+}
+int32_t GP22Kalman::getVelocity() {
+  return _v;
+}
+int32_t GP22Kalman::getInnovation() {
+  return _innovation;
+}
+uint64_t GP22Kalman::getInnovationVariance() {
+  return _innovationVariance;
+}
+uint32_t GP22Kalman::getRejectedCount() {
+  return _rejected;
+}
@@ -0,0 +1,81 @@
+#ifndef GP22Kalman_h
+#define GP22Kalman_h
+
+#include "stdint.h"
+
+// The filter state, for carrying on after a reset (see GP22Snapshot).
+// The settings (noise, gate) aren't included, they come from the sketch.
+struct GP22KalmanState {
+  int32_t x;
+  int32_t v;
+  int64_t p00;
+  int64_t p01;
+  int64_t p11;
+  bool initialised;
+};
+
+// A constant velocity Kalman tracker for the raw Q16.16 time of flight
+// values returned by GP22::readResult(). Everything is done in fixed point,
+// so it is cheap enough to run on every shot on an MCU without an FPU.
+//
+// The state is the TOF (position) and its change per sample (velocity),
+// both in raw Q16.16 LSBs. The covariances are kept in LSB^2 as 64 bit
+// integers and the gains are Q0.16 fractions.
+class GP22Kalman
+{
+public:
+  // processNoise is the variance of the TOF acceleration per sample and
+  // measurementNoise is the variance of a single shot, both in LSB^2.
+  GP22Kalman(uint32_t processNoise, uint32_t measurementNoise);
+
+  // Forget the current estimate, the next sample will initialise it.
+  void reset();
+
+  // Feed in a new raw result. Returns false if the sample was rejected by
+  // the innovation gate (the estimate is then only predicted forward).
+  bool update(int32_t measurement);
+
+  // Set the outlier gate in standard deviations of the innovation.
+  // A gate of 0 turns the gating off (the default).
+  void setGate(uint8_t sigmas);
+  uint8_t getGate();
+
+  void setProcessNoise(uint32_t processNoise);
+  void setMeasurementNoise(uint32_t measurementNoise);
+
+  // Save and restore the estimate and its covariance
+  void getState(GP22KalmanState &state);
+  void setState(const GP22KalmanState &state);
+
+  // The filtered TOF, as a raw Q16.16 result
+  int32_t getEstimate();
+  // The estimated change in TOF per sample, as a raw Q16.16 result
+  int32_t getVelocity();
+  // The innovation (measurement - prediction) of the last sample
+  int32_t getInnovation();
+  // The innovation variance of the last sample, in LSB^2
+  uint64_t getInnovationVariance();
+  // How many samples have been rejected by the gate since the last reset
+  uint32_t getRejectedCount();
+
+private:
+  void predict();
+
+  int32_t _x;
+  int32_t _v;
+  // The covariance matrix is symmetric so only three terms are needed
+  int64_t _p00;
+  int64_t _p01;
+  int64_t _p11;
+
+  uint32_t _q;
+  uint32_t _r;
+  uint8_t _gate;
+
+  bool _initialised;
+  int32_t _innovation;
+  uint64_t _innovationVariance;
+  uint32_t _rejected;
+};
+
+#endif
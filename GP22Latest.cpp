@@ -0,0 +1,54 @@
+#include "GP22Latest.h"
+
+// A full compiler and hardware memory barrier (DMB on ARM)
+#define GP22_BARRIER() __sync_synchronize()
+
+GP22Latest::GP22Latest() {
+  _begin = 0;
+  _end = 0;
+}
+
+void GP22Latest::publish(int32_t result, uint16_t status, uint32_t configGeneration, uint32_t timestamp) {
+  uint32_t next = _end + 1;
+
+  // Claim the other copy first, so readers know not to trust it.
+  _begin = next;
+  GP22_BARRIER();
+
+  volatile Copy &copy = _copies[next & 1];
+  copy.result = result;
+  copy.status = status;
+  copy.configGeneration = configGeneration;
+  copy.timestamp = timestamp;
+
+  GP22_BARRIER();
+  _end = next;
+}
+
+bool GP22Latest::read(GP22Measurement &measurement, uint8_t maxTries) {
+  for (uint8_t i = 0; i < maxTries; i++) {
+    uint32_t end = _end;
+    if (end == 0)
+      return false;
+    GP22_BARRIER();
+
+    volatile Copy &copy = _copies[end & 1];
+    measurement.result = copy.result;
+    measurement.status = copy.status;
+    measurement.configGeneration = copy.configGeneration;
+    measurement.timestamp = copy.timestamp;
+
+    GP22_BARRIER();
+    // The copy we read only gets written again once the writer is two
+    // publishes on from it.
+    if ((uint32_t)(_begin - end) < 2) {
+      measurement.sequence = end;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t GP22Latest::getSequence() {
+  return _end;
+}
@@ -0,0 +1,59 @@
+#ifndef GP22Latest_h
+#define GP22Latest_h
+
+#include "stdint.h"
+
+// The latest measurement, as handed out by GP22Latest
+struct GP22Measurement {
+  int32_t result;
+  uint16_t status;
+  uint32_t configGeneration;
+  uint32_t timestamp;
+  // How many measurements have been published, so readers can tell if it's new
+  uint32_t sequence;
+};
+
+// Publishes the most recent measurement for any number of readers (other
+// threads, ISRs, ...) that only want the latest value, not the stream.
+//
+// This is a seqlock over two copies. The writer fills in the copy that
+// readers aren't being pointed at, then moves them over to it. A reader
+// copies out the current one and then checks the writer hasn't come round
+// to that copy again in the meantime. So the writer never waits, and a
+// reader only has to retry if the writer published twice while it was
+// copying. In particular an ISR that interrupts the writer half way through
+// always gets a consistent copy first time.
+//
+// There must only be one writer. In the acquisition path, once per measurement:
+//   latest.publish(result, tdc.getStatus(), tdc.getConfigGeneration(), micros());
+class GP22Latest
+{
+public:
+  GP22Latest();
+
+  // Publish a new measurement. The sequence number is filled in here.
+  void publish(int32_t result, uint16_t status, uint32_t configGeneration, uint32_t timestamp);
+
+  // Copy out the latest measurement. Returns false if nothing has been
+  // published yet, or if the writer kept getting in the way (after maxTries).
+  bool read(GP22Measurement &measurement, uint8_t maxTries = 4);
+
+  // How many measurements have been published
+  uint32_t getSequence();
+
+private:
+  struct Copy {
+    int32_t result;
+    uint16_t status;
+    uint32_t configGeneration;
+    uint32_t timestamp;
+  };
+
+  volatile Copy _copies[2];
+  // The writer bumps _begin before it starts filling in copy (_begin & 1),
+  // and sets _end to match once it is done.
+  volatile uint32_t _begin;
+  volatile uint32_t _end;
+};
+
+#endif
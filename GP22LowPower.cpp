@@ -0,0 +1,118 @@
+#include "GP22LowPower.h"
+
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
+volatile bool GP22LowPower::_interrupted = false;
+
+GP22LowPower::GP22LowPower(GP22 &tdc, int interruptPin) : _tdc(tdc) {
+  _interruptPin = interruptPin;
+  // Something like a Due at 3.3 V, until told otherwise
+  setSupply(3300, 30000, 10000, 2);
+  _lastEnergy = 0;
+  _lastAwake = 0;
+  _lastSleep = 0;
+}
+
+void GP22LowPower::begin() {
+  pinMode(_interruptPin, INPUT);
+  // INTN is active low
+  attachInterrupt(digitalPinToInterrupt(_interruptPin), isr, FALLING);
+}
+
+void GP22LowPower::isr() {
+  _interrupted = true;
+}
+
+// The flag is checked with interrupts off, so the INTN interrupt can't slip
+// in between the check and the sleep (and leave us asleep until something
+// else comes along). A pending interrupt still wakes the core, and its ISR
+// runs once they are back on.
+void GP22LowPower::sleep() {
+#if defined(__arm__)
+  __disable_irq();
+  if (!_interrupted)
+    __WFI();
+  __enable_irq();
+#elif defined(__AVR__)
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (!_interrupted) {
+    sleep_enable();
+    // The instruction after sei() always runs first, so this can't miss it
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+#endif
+  // Anywhere else this just spins, which at least keeps the numbers honest
+}
+
+bool GP22LowPower::measure(int32_t &result, uint8_t resultRegister, uint32_t timeoutMicros) {
+  uint32_t start = micros();
+  uint32_t spiStart = _tdc.getSpiByteCount();
+  uint32_t slept = 0;
+
+  _interrupted = false;
+  _tdc.measure();
+
+  // Sleep until INTN (or a timer tick, to check the timeout)
+  while (!_interrupted && micros() - start < timeoutMicros) {
+    uint32_t before = micros();
+    sleep();
+    slept += micros() - before;
+  }
+
+  // The wake window: one status read, and the result if there is one
+  bool ok = _interrupted;
+  if (ok) {
+    _tdc.readStatus();
+    ok = !_tdc.timedOut();
+  }
+  result = ok ? _tdc.readResult(resultRegister) : 0;
+
+  uint32_t total = micros() - start;
+  _lastSleep = slept;
+  _lastAwake = total - slept;
+  _lastEnergy = energy(_lastAwake, _awakeMicroamps) + energy(_lastSleep, _sleepMicroamps) +
+    (_tdc.getSpiByteCount() - spiStart) * _spiByteNanojoules;
+
+  return ok;
+}
+
+void GP22LowPower::setSupply(uint16_t millivolts, uint32_t awakeMicroamps, uint32_t sleepMicroamps, uint16_t spiByteNanojoules) {
+  _millivolts = millivolts;
+  _awakeMicroamps = awakeMicroamps;
+  _sleepMicroamps = sleepMicroamps;
+  _spiByteNanojoules = spiByteNanojoules;
+}
+
+uint32_t GP22LowPower::energy(uint32_t micros, uint32_t microamps) {
+  // mV * uA * us = 10^-15 J, so divide by 10^6 for nJ
+  return (uint32_t)(((uint64_t)_millivolts * microamps * micros) / 1000000ULL);
+}
+
+uint32_t GP22LowPower::getLastEnergy() {
+  return _lastEnergy;
+}
+uint32_t GP22LowPower::getLastAwakeMicros() {
+  return _lastAwake;
+}
+uint32_t GP22LowPower::getLastSleepMicros() {
+  return _lastSleep;
+}
+
+uint32_t GP22LowPower::estimatePower(uint32_t periodMicros) {
+  if (periodMicros == 0)
+    return 0;
+
+  uint64_t nanojoules = _lastEnergy;
+  uint32_t used = _lastAwake + _lastSleep;
+  if (periodMicros > used)
+    nanojoules += energy(periodMicros - used, _sleepMicroamps);
+
+  // nJ / us = mW, so * 1000 for uW
+  return (uint32_t)((nanojoules * 1000) / periodMicros);
+}
@@ -0,0 +1,71 @@
+#ifndef GP22LowPower_h
+#define GP22LowPower_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// Duty cycled measurements for battery powered meters.
+// Instead of polling the status register until the result is in, the chip
+// is armed and the MCU sleeps until the GP22 pulls INTN low, then wakes for
+// just long enough to read the status and the result. The config isn't
+// touched at all; the GP22 keeps its registers between measurements, and the
+// shadow copy in the GP22 object (which has to survive the sleep) is only
+// needed if it has to be sent again.
+//
+// The sleep is a plain wait for interrupt (__WFI() on ARM, idle mode on AVR),
+// so micros() and the interrupt both keep working. Anything deeper (where
+// the timers stop) is up to the sketch, between measurements.
+//
+// The energy used is estimated from how long the MCU was awake and asleep,
+// the currents it draws in each, and the bytes that went over SPI, so the
+// measurement rate can be traded against battery life. The estimates are
+// only as good as the currents given to setSupply().
+//
+// Only one of these can be used at a time, as there is only the one ISR.
+class GP22LowPower
+{
+public:
+  // interruptPin is wired to the GP22's INTN
+  GP22LowPower(GP22 &tdc, int interruptPin);
+
+  // Attach the interrupt. Call after tdc.begin().
+  void begin();
+
+  // Arm the chip, sleep until it is done (or timeoutMicros goes by) and read
+  // the result. Returns false on a timeout (of either the chip or ours).
+  bool measure(int32_t &result, uint8_t resultRegister, uint32_t timeoutMicros);
+
+  // The supply voltage in mV, the MCU current awake and asleep in uA, and the
+  // energy each SPI byte costs (both ends of the bus), in nJ.
+  void setSupply(uint16_t millivolts, uint32_t awakeMicroamps, uint32_t sleepMicroamps, uint16_t spiByteNanojoules);
+
+  // The last measurement's estimated energy, in nJ
+  uint32_t getLastEnergy();
+  // How long the MCU was awake and asleep for in the last measurement
+  uint32_t getLastAwakeMicros();
+  uint32_t getLastSleepMicros();
+  // The average power, in uW, if a measurement (like the last one) is done
+  // every periodMicros and the MCU sleeps the rest of the time.
+  uint32_t estimatePower(uint32_t periodMicros);
+
+private:
+  static void isr();
+  void sleep();
+  uint32_t energy(uint32_t micros, uint32_t microamps);
+
+  GP22 &_tdc;
+  int _interruptPin;
+
+  uint16_t _millivolts;
+  uint32_t _awakeMicroamps;
+  uint32_t _sleepMicroamps;
+  uint16_t _spiByteNanojoules;
+
+  uint32_t _lastEnergy;
+  uint32_t _lastAwake;
+  uint32_t _lastSleep;
+
+  static volatile bool _interrupted;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "GP22Merge.h"
+
+#define GP22_MERGE_QUEUE_MASK (GP22_MERGE_QUEUE_LENGTH - 1)
+
+GP22Merge::GP22Merge(uint8_t numSources) {
+  if (numSources > GP22_MERGE_MAX_SOURCES)
+    numSources = GP22_MERGE_MAX_SOURCES;
+  _numSources = numSources;
+  clear();
+}
+
+void GP22Merge::clear() {
+  for (uint8_t i = 0; i < GP22_MERGE_MAX_SOURCES; i++) {
+    _head[i] = 0;
+    _count[i] = 0;
+    _last[i] = INT64_MIN;
+    _active[i] = i < _numSources;
+  }
+  _heapSize = 0;
+  _emptyActive = _numSources;
+  _dropped = 0;
+}
+
+int64_t GP22Merge::headTime(uint8_t source) {
+  return _queue[source][_head[source]];
+}
+
+void GP22Merge::siftUp(uint8_t pos) {
+  uint8_t source = _heap[pos];
+  int64_t time = headTime(source);
+
+  while (pos > 0) {
+    uint8_t parent = (pos - 1) / 2;
+    if (headTime(_heap[parent]) <= time)
+      break;
+    _heap[pos] = _heap[parent];
+    pos = parent;
+  }
+  _heap[pos] = source;
+}
+
+void GP22Merge::siftDown(uint8_t pos) {
+  uint8_t source = _heap[pos];
+  int64_t time = headTime(source);
+
+  while (true) {
+    uint8_t child = 2 * pos + 1;
+    if (child >= _heapSize)
+      break;
+    // Pick the earlier of the two children
+    if (child + 1 < _heapSize && headTime(_heap[child + 1]) < headTime(_heap[child]))
+      child++;
+    if (time <= headTime(_heap[child]))
+      break;
+    _heap[pos] = _heap[child];
+    pos = child;
+  }
+  _heap[pos] = source;
+}
+
+bool GP22Merge::push(uint8_t source, int64_t time) {
+  if (source >= _numSources || _count[source] >= GP22_MERGE_QUEUE_LENGTH || time < _last[source]) {
+    _dropped++;
+    return false;
+  }
+
+  uint8_t tail = (_head[source] + _count[source]) & GP22_MERGE_QUEUE_MASK;
+  _queue[source][tail] = time;
+  _last[source] = time;
+  _count[source]++;
+
+  // If the stream was empty, it needs to go into the heap.
+  if (_count[source] == 1) {
+    if (_active[source])
+      _emptyActive--;
+    _heap[_heapSize] = source;
+    _heapSize++;
+    siftUp(_heapSize - 1);
+  }
+
+  return true;
+}
+
+bool GP22Merge::pop(GP22Event &event, bool force) {
+  if (_heapSize == 0)
+    return false;
+  // Wait until every active stream has had its say
+  if (_emptyActive > 0 && !force)
+    return false;
+
+  uint8_t source = _heap[0];
+  event.time = headTime(source);
+  event.source = source;
+
+  _head[source] = (_head[source] + 1) & GP22_MERGE_QUEUE_MASK;
+  _count[source]--;
+
+  if (_count[source] > 0) {
+    // The stream has a new head time, so it needs to move down the heap.
+    siftDown(0);
+  } else {
+    // The stream is empty, so take it out of the heap.
+    if (_active[source])
+      _emptyActive++;
+    _heapSize--;
+    if (_heapSize > 0) {
+      _heap[0] = _heap[_heapSize];
+      siftDown(0);
+    }
+  }
+
+  return true;
+}
+
+void GP22Merge::setActive(uint8_t source, bool active) {
+  if (source >= _numSources || _active[source] == active)
+    return;
+
+  _active[source] = active;
+  // Only empty streams are counted as holding things up
+  if (_count[source] == 0) {
+    if (active)
+      _emptyActive++;
+    else
+      _emptyActive--;
+  }
+}
+bool GP22Merge::isActive(uint8_t source) {
+  if (source < _numSources)
+    return _active[source];
+  else
+    return false;
+}
+
+uint8_t GP22Merge::getNumSources() {
+  return _numSources;
+}
+uint32_t GP22Merge::getDroppedCount() {
+  return _dropped;
+}
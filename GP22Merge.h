@@ -0,0 +1,71 @@
+#ifndef GP22Merge_h
+#define GP22Merge_h
+
+#include "stdint.h"
+
+// The most streams that can be merged
+#define GP22_MERGE_MAX_SOURCES 8
+// How many events each stream can have queued up (must be a power of 2)
+#define GP22_MERGE_QUEUE_LENGTH 16
+
+// A timestamped event, and the stream it came from
+struct GP22Event {
+  int64_t time;
+  uint8_t source;
+};
+
+// Merges several streams of timestamped events, each already in time order,
+// into one time ordered stream. The next event is found with a binary heap
+// over the head of each stream, so it is O(log k) per event for k streams,
+// and the memory used is fixed by the queue length.
+//
+// An event can only be handed out once every active stream has something
+// queued, as until then an earlier event could still turn up. Streams that
+// have stopped (timed out, been unplugged, ...) should be made inactive.
+class GP22Merge
+{
+public:
+  GP22Merge(uint8_t numSources);
+
+  // Empty all the queues and make every stream active again.
+  void clear();
+
+  // Queue up an event from a stream. This fails if the queue is full or the
+  // event is earlier than the last one from that stream.
+  bool push(uint8_t source, int64_t time);
+
+  // Get the next event in time order, if it is safe to do so.
+  // If force is set, the event is handed out even if a stream is empty
+  // (which is what is wanted at the end of a run).
+  bool pop(GP22Event &event, bool force = false);
+
+  // Inactive streams are not waited for.
+  void setActive(uint8_t source, bool active);
+  bool isActive(uint8_t source);
+
+  uint8_t getNumSources();
+  // How many events have been dropped due to full queues or bad ordering
+  uint32_t getDroppedCount();
+
+private:
+  void siftUp(uint8_t pos);
+  void siftDown(uint8_t pos);
+  int64_t headTime(uint8_t source);
+
+  uint8_t _numSources;
+  int64_t _queue[GP22_MERGE_MAX_SOURCES][GP22_MERGE_QUEUE_LENGTH];
+  uint8_t _head[GP22_MERGE_MAX_SOURCES];
+  uint8_t _count[GP22_MERGE_MAX_SOURCES];
+  int64_t _last[GP22_MERGE_MAX_SOURCES];
+  bool _active[GP22_MERGE_MAX_SOURCES];
+
+  // A min heap of the streams that have events, ordered by their head time
+  uint8_t _heap[GP22_MERGE_MAX_SOURCES];
+  uint8_t _heapSize;
+  // How many active streams have nothing queued
+  uint8_t _emptyActive;
+
+  uint32_t _dropped;
+};
+
+#endif
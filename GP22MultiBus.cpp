@@ -0,0 +1,157 @@
+#include "GP22MultiBus.h"
+
+#define GP22_MULTIBUS_QUEUE_MASK (GP22_MULTIBUS_QUEUE_LENGTH - 1)
+
+GP22MultiBus::GP22MultiBus(GP22TimeSource clock) : _merge(GP22_MULTIBUS_MAX_CHIPS) {
+  _clock = clock;
+  _numBuses = 0;
+  _numChips = 0;
+  _dropped = 0;
+  for (uint8_t i = 0; i < GP22_MULTIBUS_MAX_CHIPS; i++) {
+    _queues[i].head = 0;
+    _queues[i].tail = 0;
+    _queues[i].admitted = 0;
+    _queues[i].lastTime = INT64_MIN;
+    _armed[i] = 0;
+    // Chips that haven't been added mustn't hold up the merge
+    _merge.setActive(i, false);
+  }
+}
+
+int8_t GP22MultiBus::addBus(GP22Bus * bus) {
+  if (_numBuses >= GP22_MULTIBUS_MAX_BUSES || bus == NULL)
+    return -1;
+  _buses[_numBuses] = bus;
+  return _numBuses++;
+}
+
+int8_t GP22MultiBus::addChip(GP22 * tdc, uint8_t bus) {
+  if (_numChips >= GP22_MULTIBUS_MAX_CHIPS || bus >= _numBuses || tdc == NULL)
+    return -1;
+  tdc->setBus(_buses[bus]);
+  _chips[_numChips] = tdc;
+  _chipBus[_numChips] = bus;
+  _merge.setActive(_numChips, true);
+  return _numChips++;
+}
+
+uint8_t GP22MultiBus::getNumBuses() {
+  return _numBuses;
+}
+uint8_t GP22MultiBus::getNumChips() {
+  return _numChips;
+}
+uint8_t GP22MultiBus::getBusOf(uint8_t chip) {
+  return _chipBus[chip];
+}
+
+bool GP22MultiBus::queueResult(uint8_t chip, const GP22ChipResult &result) {
+  ChipQueue &queue = _queues[chip];
+  uint16_t head = queue.head;
+  if ((uint16_t)(head - queue.tail) >= GP22_MULTIBUS_QUEUE_LENGTH) {
+    __sync_fetch_and_add(&_dropped, 1);
+    return false;
+  }
+
+  queue.items[head & GP22_MULTIBUS_QUEUE_MASK] = result;
+  // The item has to be written before the consumer can see it
+  __sync_synchronize();
+  queue.head = head + 1;
+  return true;
+}
+
+void GP22MultiBus::armBus(uint8_t bus) {
+  // Arm every chip on the bus before collecting any, so their measurements overlap
+  for (uint8_t i = 0; i < _numChips; i++) {
+    if (_chipBus[i] != bus)
+      continue;
+    _chips[i]->measure();
+    _armed[i] = _clock();
+  }
+}
+
+uint8_t GP22MultiBus::collectBus(uint8_t bus, uint16_t maxPolls) {
+  if (bus >= _numBuses)
+    return 0;
+
+  // By the time the later chips are polled they have usually finished, so
+  // this mostly costs one status read each.
+  uint8_t queued = 0;
+  for (uint8_t i = 0; i < _numChips; i++) {
+    if (_chipBus[i] != bus)
+      continue;
+
+    GP22 * tdc = _chips[i];
+    GP22ChipResult result;
+    result.chip = i;
+    result.valid = tdc->waitForResult(maxPolls);
+    result.status = tdc->getStatus();
+    // The read pointer is one past the latest result
+    result.result = result.valid ? tdc->readResult(tdc->getReadPointer() - 1) : 0;
+    result.time = _armed[i] + (result.result > 0 ? result.result : 0);
+
+    ChipQueue &queue = _queues[i];
+    if (result.time < queue.lastTime)
+      result.time = queue.lastTime;
+    queue.lastTime = result.time;
+
+    // Timeouts are queued as well, so the merge isn't left waiting on this chip
+    if (queueResult(i, result))
+      queued++;
+  }
+
+  return queued;
+}
+
+uint8_t GP22MultiBus::serviceBus(uint8_t bus, uint16_t maxPolls) {
+  if (bus >= _numBuses)
+    return 0;
+  armBus(bus);
+  return collectBus(bus, maxPolls);
+}
+
+void GP22MultiBus::serviceAll(uint16_t maxPolls) {
+  // Everything is armed before anything is waited on, so the buses'
+  // measurements overlap even though their transfers can't
+  for (uint8_t bus = 0; bus < _numBuses; bus++)
+    armBus(bus);
+  for (uint8_t bus = 0; bus < _numBuses; bus++)
+    collectBus(bus, maxPolls);
+}
+
+bool GP22MultiBus::next(GP22ChipResult &result, bool force) {
+  // Hand whatever the buses have queued to the merge. The merge only keeps
+  // the times, the results stay in the chip's queue until they're popped.
+  for (uint8_t i = 0; i < _numChips; i++) {
+    ChipQueue &queue = _queues[i];
+    uint16_t head = queue.head;
+    __sync_synchronize();
+    while (queue.admitted < GP22_MERGE_QUEUE_LENGTH && (uint16_t)(head - queue.tail) > queue.admitted) {
+      uint16_t index = (queue.tail + queue.admitted) & GP22_MULTIBUS_QUEUE_MASK;
+      _merge.push(i, queue.items[index].time);
+      queue.admitted++;
+    }
+  }
+
+  GP22Event event;
+  if (!_merge.pop(event, force))
+    return false;
+
+  // Each chip's results go through the merge in order, so it's the oldest one
+  ChipQueue &queue = _queues[event.source];
+  result = queue.items[queue.tail & GP22_MULTIBUS_QUEUE_MASK];
+  queue.admitted--;
+  // Done with the item before the bus can reuse its slot
+  __sync_synchronize();
+  queue.tail = queue.tail + 1;
+  return true;
+}
+
+void GP22MultiBus::setChipActive(uint8_t chip, bool active) {
+  if (chip < _numChips)
+    _merge.setActive(chip, active);
+}
+
+uint32_t GP22MultiBus::getDroppedCount() {
+  return _dropped;
+}
@@ -0,0 +1,114 @@
+#ifndef GP22MultiBus_h
+#define GP22MultiBus_h
+
+#include "stdint.h"
+#include "GP22.h"
+#include "GP22Bus.h"
+#include "GP22Merge.h"
+
+#define GP22_MULTIBUS_MAX_BUSES 4
+// One merge stream per chip, so this can't be more than the merge allows
+#define GP22_MULTIBUS_MAX_CHIPS GP22_MERGE_MAX_SOURCES
+// Results each chip can have waiting to be merged (must be a power of 2)
+#define GP22_MULTIBUS_QUEUE_LENGTH 32
+
+// The time now, as raw Q16.16 TDC clock periods, e.g. micros() * 4 << 16
+typedef int64_t (*GP22TimeSource)();
+
+// A result from one of the chips, timestamped on the common timebase
+struct GP22ChipResult {
+  int64_t time;
+  int32_t result;
+  uint16_t status;
+  uint8_t chip;
+  // Timed out results still come through (so the merge isn't held up),
+  // with this cleared
+  bool valid;
+};
+
+// Spreads GP22s over several SPI buses (controllers, each a GP22Transport
+// such as SPI0, a USART in SPI mode or a spidev node) so that the bus time
+// adds up, rather than every chip queueing on one bus.
+//
+// Each chip is assigned to a bus. An acquisition round on a bus is in two
+// phases: armBus() arms its chips, and collectBus() polls them and queues
+// up the results. serviceBus() does both, for a thread per bus (on Linux),
+// where the buses really do run at the same time.
+//
+// With one thread (e.g. on the Due), serviceAll() arms every chip on every
+// bus before collecting from any of them, so the chips' measurements all
+// overlap. The SPI transfers themselves still go one at a time, as the CPU
+// drives each controller in turn, so a second controller only adds
+// capacity where the measurement time (not the bus time) is the limit.
+//
+// The results of all the chips are then merged back into one stream in
+// time order by next(), which should only be called from one thread.
+//
+// A result's time is when its chip was armed plus the result itself, so
+// this assumes the result is the time from the start of the measurement.
+// If the clock jitters backwards, a chip's results are held at its last time
+// so its stream stays in order.
+class GP22MultiBus
+{
+public:
+  GP22MultiBus(GP22TimeSource clock);
+
+  // Returns the bus index, or -1 if there's no room
+  int8_t addBus(GP22Bus * bus);
+  // Put a chip on a bus (this calls setBus() on it, so do it before begin()).
+  // Returns the chip index, or -1 if there's no room.
+  int8_t addChip(GP22 * tdc, uint8_t bus);
+
+  uint8_t getNumBuses();
+  uint8_t getNumChips();
+  uint8_t getBusOf(uint8_t chip);
+
+  // Arm every chip on one bus.
+  void armBus(uint8_t bus);
+  // Collect the results of a bus's chips after armBus(), waiting up to
+  // maxPolls status reads for each chip. Returns how many results were
+  // queued (results that don't fit are dropped and counted).
+  uint8_t collectBus(uint8_t bus, uint16_t maxPolls = 1000);
+  // Run one whole acquisition round on one bus, for a thread per bus.
+  uint8_t serviceBus(uint8_t bus, uint16_t maxPolls = 1000);
+  // Arm every bus, then collect from each, for single threaded use.
+  void serviceAll(uint16_t maxPolls = 1000);
+
+  // Get the next result in time order. Returns false if there's nothing
+  // that can be handed out yet. Set force at the end of a run to empty it.
+  bool next(GP22ChipResult &result, bool force = false);
+
+  // Chips that have been taken out of service shouldn't hold up the merge
+  void setChipActive(uint8_t chip, bool active);
+
+  uint32_t getDroppedCount();
+
+private:
+  // A single producer (the bus) single consumer (next()) queue per chip.
+  struct ChipQueue {
+    GP22ChipResult items[GP22_MULTIBUS_QUEUE_LENGTH];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    // How many of the queued items have been handed to the merge
+    uint16_t admitted;
+    // Only used by the bus, to keep each chip's results in order
+    int64_t lastTime;
+  };
+
+  bool queueResult(uint8_t chip, const GP22ChipResult &result);
+
+  GP22TimeSource _clock;
+  GP22Bus * _buses[GP22_MULTIBUS_MAX_BUSES];
+  uint8_t _numBuses;
+  GP22 * _chips[GP22_MULTIBUS_MAX_CHIPS];
+  uint8_t _chipBus[GP22_MULTIBUS_MAX_CHIPS];
+  // When each chip was last armed (only touched by its bus)
+  int64_t _armed[GP22_MULTIBUS_MAX_CHIPS];
+  uint8_t _numChips;
+
+  ChipQueue _queues[GP22_MULTIBUS_MAX_CHIPS];
+  GP22Merge _merge;
+  volatile uint32_t _dropped;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "GP22MultiPath.h"
+
+// How many rounds of status reads to wait for the shots
+#define GP22_MULTIPATH_MAX_POLLS 1000
+
+GP22MultiPath::GP22MultiPath(GP22PathDirectionCallback direction) {
+  _direction = direction;
+  _numPaths = 0;
+  _area = 0;
+  _updates = 0;
+  _velocity = 0;
+  _pathsUsed = 0;
+}
+
+bool GP22MultiPath::addPath(GP22 * tdc, float lengthMm, float angleDegrees) {
+  if (_numPaths >= GP22_MULTIPATH_MAX_PATHS || tdc == NULL)
+    return false;
+
+  Path &path = _paths[_numPaths];
+  path.tdc = tdc;
+
+  // The per path constant is L / (2 cos(angle)) * the TDC clock, so that
+  // v = coefficient * dt / (t_up * t_down) with the times in clock periods.
+  // This is only done at setup, so floats are fine here.
+  float cosAngle = cos(angleDegrees * M_PI / 180.0);
+  float clock = (float)GP22_REF_CLOCK_HZ / tdc->getClkPreDiv();
+  path.coefficient = (cosAngle > 0) ? (uint64_t)(lengthMm / (2.0 * cosAngle) * clock) : 0;
+
+  path.weight = 65536;
+  path.up = 0;
+  path.down = 0;
+  path.velocity = 0;
+  path.valid = false;
+  path.consecutiveFails = 0;
+  path.fails = 0;
+
+  _numPaths++;
+  return true;
+}
+uint8_t GP22MultiPath::getNumPaths() {
+  return _numPaths;
+}
+
+void GP22MultiPath::setWeight(uint8_t path, uint32_t weight) {
+  if (path < _numPaths)
+    _paths[path].weight = weight;
+}
+uint32_t GP22MultiPath::getWeight(uint8_t path) {
+  if (path < _numPaths)
+    return _paths[path].weight;
+  else
+    return 0;
+}
+
+void GP22MultiPath::setChebyshevWeights() {
+  if (_numPaths == 0)
+    return;
+
+  // w_i is proportional to sin^2(i pi / (N + 1)), normalised to sum to 1.
+  float raw[GP22_MULTIPATH_MAX_PATHS];
+  float total = 0;
+  for (uint8_t i = 0; i < _numPaths; i++) {
+    float s = sin((i + 1) * M_PI / (_numPaths + 1));
+    raw[i] = s * s;
+    total += raw[i];
+  }
+  for (uint8_t i = 0; i < _numPaths; i++)
+    _paths[i].weight = (uint32_t)(raw[i] / total * 65536.0 + 0.5);
+}
+
+void GP22MultiPath::setPipeArea(uint32_t areaMm2) {
+  _area = areaMm2;
+}
+
+bool GP22MultiPath::shouldRun(uint8_t path) {
+  // Unhealthy paths only get the odd retry, so they don't keep eating
+  // into the update period with timeouts.
+  return _paths[path].consecutiveFails < GP22_MULTIPATH_FAIL_LIMIT
+      || (_updates % GP22_MULTIPATH_RETRY_INTERVAL) == 0;
+}
+
+void GP22MultiPath::runShots(bool up, bool * active) {
+  bool done[GP22_MULTIPATH_MAX_PATHS];
+  uint8_t remaining = 0;
+  for (uint8_t i = 0; i < _numPaths; i++) {
+    done[i] = !active[i];
+    if (!done[i])
+      remaining++;
+  }
+
+  while (remaining > 0) {
+    // Arm every path whose chip isn't already busy this round
+    bool armed[GP22_MULTIPATH_MAX_PATHS];
+    uint8_t waiting = 0;
+    for (uint8_t i = 0; i < _numPaths; i++) {
+      armed[i] = false;
+      if (done[i])
+        continue;
+
+      bool chipBusy = false;
+      for (uint8_t j = 0; j < i; j++) {
+        if (armed[j] && _paths[j].tdc == _paths[i].tdc)
+          chipBusy = true;
+      }
+      if (chipBusy)
+        continue;
+
+      if (_direction)
+        _direction(i, up);
+      _paths[i].tdc->measure();
+      armed[i] = true;
+      waiting++;
+    }
+
+    // Now poll them all together, picking results up as they come in
+    for (uint16_t poll = 0; poll < GP22_MULTIPATH_MAX_POLLS && waiting > 0; poll++) {
+      for (uint8_t i = 0; i < _numPaths; i++) {
+        if (!armed[i] || done[i])
+          continue;
+
+        GP22 * tdc = _paths[i].tdc;
+        tdc->readStatus();
+        if (tdc->timedOut()) {
+          active[i] = false;
+        } else if (tdc->getReadPointer() > 0) {
+          if (up)
+            _paths[i].up = tdc->readResult(0);
+          else
+            _paths[i].down = tdc->readResult(0);
+        } else {
+          continue;
+        }
+        done[i] = true;
+        waiting--;
+        remaining--;
+      }
+    }
+
+    // Anything that still hasn't answered has failed
+    for (uint8_t i = 0; i < _numPaths; i++) {
+      if (armed[i] && !done[i]) {
+        active[i] = false;
+        done[i] = true;
+        remaining--;
+      }
+    }
+  }
+}
+
+bool GP22MultiPath::update() {
+  _updates++;
+
+  bool attempted[GP22_MULTIPATH_MAX_PATHS];
+  bool active[GP22_MULTIPATH_MAX_PATHS];
+  for (uint8_t i = 0; i < _numPaths; i++) {
+    attempted[i] = shouldRun(i);
+    active[i] = attempted[i];
+    _paths[i].valid = false;
+  }
+
+  runShots(true, active);
+  runShots(false, active);
+
+  int64_t weightedSum = 0;
+  uint64_t weightTotal = 0;
+  _pathsUsed = 0;
+
+  for (uint8_t i = 0; i < _numPaths; i++) {
+    if (!attempted[i])
+      continue;
+
+    Path &path = _paths[i];
+    // t_up * t_down in Q16 clock periods^2, with the extra fraction bits
+    // dropped so it fits. The dt side is shifted up to match.
+    uint64_t product = 0;
+    if (active[i] && path.up > 0 && path.down > 0)
+      product = ((uint64_t)path.up * (uint64_t)path.down) >> 24;
+
+    if (product == 0) {
+      path.fails++;
+      if (path.consecutiveFails < 255)
+        path.consecutiveFails++;
+      continue;
+    }
+
+    int64_t dt = (int64_t)path.up - path.down;
+    path.velocity = (int32_t)(((dt * (int64_t)path.coefficient) << 8) / (int64_t)product);
+    path.valid = true;
+    path.consecutiveFails = 0;
+
+    weightedSum += (int64_t)path.velocity * path.weight;
+    weightTotal += path.weight;
+    _pathsUsed++;
+  }
+
+  if (weightTotal == 0)
+    return false;
+
+  // Renormalise over the paths that made it
+  _velocity = (int32_t)(weightedSum / (int64_t)weightTotal);
+  return true;
+}
+
+int32_t GP22MultiPath::getVelocity() {
+  return _velocity;
+}
+int32_t GP22MultiPath::getFlow() {
+  // mm/s * mm^2 = uL/s, and there are a million of those in a litre
+  return (int32_t)(((int64_t)_velocity * _area) / 1000000);
+}
+
+int32_t GP22MultiPath::getPathVelocity(uint8_t path) {
+  if (path < _numPaths && _paths[path].valid)
+    return _paths[path].velocity;
+  else
+    return 0;
+}
+bool GP22MultiPath::isPathHealthy(uint8_t path) {
+  if (path < _numPaths)
+    return _paths[path].consecutiveFails < GP22_MULTIPATH_FAIL_LIMIT;
+  else
+    return false;
+}
+uint8_t GP22MultiPath::getPathsUsed() {
+  return _pathsUsed;
+}
+uint32_t GP22MultiPath::getPathFailCount(uint8_t path) {
+  if (path < _numPaths)
+    return _paths[path].fails;
+  else
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef GP22MultiPath_h
+#define GP22MultiPath_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// The most acoustic paths (chords) that can be combined
+#define GP22_MULTIPATH_MAX_PATHS 8
+// A path is unhealthy after this many failed cycles in a row
+#define GP22_MULTIPATH_FAIL_LIMIT 3
+// Unhealthy paths are only retried every this many updates
+#define GP22_MULTIPATH_RETRY_INTERVAL 8
+
+// Switch a path's transducers over for upstream (up = true) or downstream
+typedef void (*GP22PathDirectionCallback)(uint8_t path, bool up);
+
+// A multi-path (multi-chord) ultrasonic flow meter.
+// Every update runs an upstream and a downstream shot on each path. Paths on
+// different GP22s are armed together and polled together, paths that share
+// a chip take turns. Each path's mean velocity comes from
+//   v = L / (2 cos(angle)) * (t_up - t_down) / (t_up * t_down)
+// in integer arithmetic, and the paths are combined with fixed point chord
+// weights. If a path fails it is left out and the weights of the rest are
+// scaled up, so the meter degrades gracefully rather than stopping.
+class GP22MultiPath
+{
+public:
+  GP22MultiPath(GP22PathDirectionCallback direction);
+
+  // Set up a path. The length is the acoustic path length and the angle is
+  // between the path and the pipe axis. Returns false if there is no room.
+  bool addPath(GP22 * tdc, float lengthMm, float angleDegrees);
+  uint8_t getNumPaths();
+
+  // Set the weight of a path directly, in Q16 (65536 = 1)
+  void setWeight(uint8_t path, uint32_t weight);
+  uint32_t getWeight(uint8_t path);
+  // Weight the paths for chords at the Chebyshev (Gauss-Jacobi) positions,
+  // in the order they were added. These are the usual weights for chords at
+  // d/R = cos(i pi / (N + 1)).
+  void setChebyshevWeights();
+  // The cross sectional area of the pipe, for getFlow()
+  void setPipeArea(uint32_t areaMm2);
+
+  // Run one up/down cycle on every path and combine the results.
+  // Returns false if no path gave a result.
+  bool update();
+
+  // The weighted mean velocity, in Q16.16 mm/s
+  int32_t getVelocity();
+  // The volume flow, in Q16.16 litres per second
+  int32_t getFlow();
+
+  // A path's velocity from the last update, in Q16.16 mm/s
+  int32_t getPathVelocity(uint8_t path);
+  bool isPathHealthy(uint8_t path);
+  // How many paths went into the last update
+  uint8_t getPathsUsed();
+  uint32_t getPathFailCount(uint8_t path);
+
+private:
+  struct Path {
+    GP22 * tdc;
+    uint64_t coefficient;
+    uint32_t weight;
+    int32_t up;
+    int32_t down;
+    int32_t velocity;
+    bool valid;
+    uint8_t consecutiveFails;
+    uint32_t fails;
+  };
+
+  bool shouldRun(uint8_t path);
+  void runShots(bool up, bool * active);
+
+  GP22PathDirectionCallback _direction;
+  Path _paths[GP22_MULTIPATH_MAX_PATHS];
+  uint8_t _numPaths;
+  uint32_t _area;
+  uint32_t _updates;
+
+  int32_t _velocity;
+  uint8_t _pathsUsed;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "GP22Recorder.h"
+
+GP22Recorder::GP22Recorder(GP22TraceRecord * buffer, uint16_t length) {
+  // Round the length down to a power of 2, so the index is just a mask
+  uint16_t size = 1;
+  while (length > 0 && size <= length / 2)
+    size <<= 1;
+
+  _buffer = buffer;
+  _length = length > 0 ? size : 0;
+  _mask = size - 1;
+  _next = 0;
+  _enabled = _length > 0;
+  _clockHz = GP22_CYCLES_HZ;
+}
+
+void GP22Recorder::setEnabled(bool on) {
+  _enabled = on && _length > 0;
+}
+bool GP22Recorder::isEnabled() {
+  return _enabled;
+}
+void GP22Recorder::clear() {
+  _next = 0;
+}
+
+void GP22Recorder::setClockHz(uint32_t hz) {
+  _clockHz = hz;
+}
+
+uint32_t GP22Recorder::getCount() {
+  return _next;
+}
+
+size_t GP22Recorder::dump(Print &out) {
+  uint32_t next = _next;
+  uint16_t count = next < _length ? next : _length;
+
+  GP22TraceHeader header;
+  header.count = count;
+  header.clockHz = _clockHz;
+  header.lost = next - count;
+
+  uint8_t bytes[GP22_TRACE_HEADER];
+  gp22TraceEncodeHeader(bytes, header);
+  uint16_t crc = gp22Crc16(bytes, GP22_TRACE_HEADER);
+  size_t written = out.write(bytes, GP22_TRACE_HEADER);
+
+  for (uint16_t i = 0; i < count; i++) {
+    gp22TraceEncodeRecord(bytes, _buffer[(next - count + i) & _mask]);
+    crc = gp22Crc16(bytes, GP22_TRACE_RECORD, crc);
+    written += out.write(bytes, GP22_TRACE_RECORD);
+  }
+
+  gp22PutLE16(bytes, crc);
+  written += out.write(bytes, 2);
+  return written;
+}
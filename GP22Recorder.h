@@ -0,0 +1,71 @@
+#ifndef GP22Recorder_h
+#define GP22Recorder_h
+
+#include "stdint.h"
+#include "Print.h"
+#include "GP22Cycles.h"
+#include "GP22TraceFormat.h"
+
+// A flight recorder of the last SPI transactions, for working out what led
+// up to a problem in the field. Attach it with GP22::setRecorder() and every
+// opcode, the bytes sent and received and a cycle counter timestamp go into
+// a ring buffer, overwriting the oldest. dump() writes it out in the format
+// in GP22TraceFormat.h, for extras/linux/gp22_trace_dump.
+//
+// The buffer is supplied by the sketch, and its length must be a power of 2.
+// A slot is claimed with a single atomic add, so several chips (or threads)
+// can share one recorder without locking, and a record costs a couple of
+// stores per byte. Call gp22CyclesBegin() once at startup for the timestamps.
+//
+// Recording should be stopped (setEnabled(false)) around a dump, or the
+// newest records could be half written.
+class GP22Recorder
+{
+public:
+  GP22Recorder(GP22TraceRecord * buffer, uint16_t length);
+
+  // This is inline as it sits in every transfer. The bytes are packed most
+  // significant first, in the order they went over the wire.
+  void record(uint8_t source, uint8_t opcode, uint8_t length, uint32_t tx, uint32_t rx) {
+    if (!_enabled)
+      return;
+    GP22TraceRecord &entry = _buffer[__sync_fetch_and_add(&_next, 1) & _mask];
+    entry.cycles = gp22Cycles();
+    entry.source = source;
+    entry.opcode = opcode;
+    entry.length = length;
+    entry.flags = 0;
+    entry.tx[0] = tx >> 24;
+    entry.tx[1] = tx >> 16;
+    entry.tx[2] = tx >> 8;
+    entry.tx[3] = tx;
+    entry.rx[0] = rx >> 24;
+    entry.rx[1] = rx >> 16;
+    entry.rx[2] = rx >> 8;
+    entry.rx[3] = rx;
+  }
+
+  void setEnabled(bool on);
+  bool isEnabled();
+  // Forget everything recorded so far
+  void clear();
+
+  // How fast the timestamps count, for the dump (GP22_CYCLES_HZ by default)
+  void setClockHz(uint32_t hz);
+
+  // How many transactions have been recorded (it wraps around)
+  uint32_t getCount();
+
+  // Write the buffer out, oldest first. Returns the number of bytes written.
+  size_t dump(Print &out);
+
+private:
+  GP22TraceRecord * _buffer;
+  uint16_t _length;
+  uint16_t _mask;
+  volatile uint32_t _next;
+  volatile bool _enabled;
+  uint32_t _clockHz;
+};
+
+#endif
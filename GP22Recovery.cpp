@@ -0,0 +1,142 @@
+#include "GP22Recovery.h"
+
+GP22Recovery::GP22Recovery(GP22 &tdc) : _tdc(tdc) {
+  _failuresPerLevel = 2;
+  _recovering = false;
+  _level = REWRITE_RECOVERY;
+  _failuresAtLevel = 0;
+  _lastStep = REARM_RECOVERY;
+  _recoveryStart = 0;
+  clearStats();
+}
+
+void GP22Recovery::setFailuresPerLevel(uint8_t failures) {
+  _failuresPerLevel = failures > 0 ? failures : 1;
+}
+
+bool GP22Recovery::measure(int32_t &result, uint8_t resultRegister, uint16_t maxPolls) {
+  _tdc.measure();
+  bool ok = _tdc.waitForResult(maxPolls);
+  result = ok ? _tdc.readResult(resultRegister) : 0;
+  onMeasurement(ok);
+  return ok;
+}
+
+bool GP22Recovery::onMeasurement(bool ok) {
+  if (ok) {
+    if (_recovering) {
+      // Whatever was done last is what fixed it
+      uint32_t time = micros() - _recoveryStart;
+      GP22RecoveryStats &stats = _stats[_lastStep];
+      stats.recoveries++;
+      stats.totalMicros += time;
+      if (time > stats.maxMicros)
+        stats.maxMicros = time;
+
+      _recent[_recentNext] = time;
+      _recentNext = (_recentNext + 1) % GP22_RECOVERY_RECENT;
+      if (_recentCount < GP22_RECOVERY_RECENT)
+        _recentCount++;
+    }
+    _recovering = false;
+    _level = REWRITE_RECOVERY;
+    _failuresAtLevel = 0;
+    return false;
+  }
+
+  if (!_recovering) {
+    _recovering = true;
+    _recoveryStart = micros();
+  }
+
+  RecoveryLevel taken = step((RecoveryLevel)_level);
+
+  // A forced reset leaves a freshly configured chip, so start again from the
+  // bottom rather than going on to reconfigure and reset it again
+  if (taken == RESET_RECOVERY && _level < RESET_RECOVERY) {
+    _level = REWRITE_RECOVERY;
+    _failuresAtLevel = 0;
+    return true;
+  }
+
+  // Move up once this level has had its chances (the top level just repeats)
+  _failuresAtLevel++;
+  if (_failuresAtLevel >= _failuresPerLevel && _level < RESET_RECOVERY) {
+    _level++;
+    _failuresAtLevel = 0;
+  }
+  return true;
+}
+
+RecoveryLevel GP22Recovery::step(RecoveryLevel level) {
+  switch (level) {
+    case REARM_RECOVERY:
+    case REWRITE_RECOVERY:
+      // Nothing wrong with the registers, the next Init re-arms it
+      if (_tdc.testComms()) {
+        level = REARM_RECOVERY;
+        break;
+      }
+      _tdc.writeRegister(1);
+      // If it still doesn't read back, the chip isn't listening (or has
+      // been reset), so there's no point in the steps in between.
+      if (_tdc.testComms()) {
+        level = REWRITE_RECOVERY;
+      } else {
+        level = RESET_RECOVERY;
+        _tdc.begin();
+      }
+      break;
+
+    case RECONFIG_RECOVERY:
+      _tdc.updateConfig();
+      break;
+
+    case RESET_RECOVERY:
+      _tdc.begin();
+      break;
+  }
+
+  _stats[level].attempts++;
+  _lastStep = level;
+  return level;
+}
+
+bool GP22Recovery::isRecovering() {
+  return _recovering;
+}
+RecoveryLevel GP22Recovery::getLevel() {
+  return (RecoveryLevel)_level;
+}
+
+GP22RecoveryStats GP22Recovery::getStats(RecoveryLevel level) {
+  if (level < RECOVERY_LEVELS)
+    return _stats[level];
+  else
+    return GP22RecoveryStats();
+}
+
+uint32_t GP22Recovery::getMedianMicros() {
+  if (_recentCount == 0)
+    return 0;
+
+  // Only a handful, so an insertion sort of a copy is fine
+  uint32_t sorted[GP22_RECOVERY_RECENT];
+  for (uint8_t i = 0; i < _recentCount; i++) {
+    uint32_t value = _recent[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > value) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = value;
+  }
+  return sorted[_recentCount / 2];
+}
+
+void GP22Recovery::clearStats() {
+  for (uint8_t i = 0; i < RECOVERY_LEVELS; i++)
+    _stats[i] = GP22RecoveryStats();
+  _recentCount = 0;
+  _recentNext = 0;
+}
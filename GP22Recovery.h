@@ -0,0 +1,89 @@
+#ifndef GP22Recovery_h
+#define GP22Recovery_h
+
+#include "stdint.h"
+#include "GP22.h"
+
+// The recovery steps, cheapest first
+enum RecoveryLevel: uint8_t {
+  REARM_RECOVERY,    // Register 1 checked out, so only the next measurement's Init was needed
+  REWRITE_RECOVERY,  // Check register 1 (the only one that can be read back) and rewrite it if it's wrong
+  RECONFIG_RECOVERY, // Rewrite all of the registers
+  RESET_RECOVERY     // Power on reset and rewrite everything (begin())
+};
+#define RECOVERY_LEVELS 4
+
+// How many recovery times the median is taken over
+#define GP22_RECOVERY_RECENT 16
+
+// Statistics for one recovery level
+struct GP22RecoveryStats {
+  // How many times the step was taken
+  uint32_t attempts;
+  // How many times it was the last step before things worked again
+  uint32_t recoveries;
+  // The time from the first failure to the next good measurement, for the
+  // recoveries at this level
+  uint32_t totalMicros;
+  uint32_t maxMicros;
+};
+
+// Gets the chip going again after timeouts or comms failures with as little
+// reconfiguration as it can. Most glitches (a missed start, a noisy stop) go
+// away with the next measurement, so the first step is just to check that
+// register 1 still reads back (a two byte read, only rewritten if it's
+// wrong). If it reads back fine nothing is done, and the step is counted as
+// a re-arm, as the next measurement's Init is all the chip gets. Only if
+// failures keep coming does it move on to rewriting the whole config and
+// finally a full reset.
+//
+// Feed it the outcome of every measurement with onMeasurement(), or let it
+// run the measurements with measure(). After failuresPerLevel failures in a
+// row at a level it moves up to the next one, and a good measurement brings
+// it back down to the start.
+class GP22Recovery
+{
+public:
+  GP22Recovery(GP22 &tdc);
+
+  // How many failures in a row before moving up a level (at least 1)
+  void setFailuresPerLevel(uint8_t failures);
+
+  // Arm, wait for and read a result, recovering if it fails.
+  bool measure(int32_t &result, uint8_t resultRegister, uint16_t maxPolls);
+
+  // Tell it how the last measurement went. Returns true if it took a
+  // recovery step.
+  bool onMeasurement(bool ok);
+
+  bool isRecovering();
+  // The level the next failure will be handled at (never REARM_RECOVERY,
+  // that is only a level for the statistics)
+  RecoveryLevel getLevel();
+
+  GP22RecoveryStats getStats(RecoveryLevel level);
+  // The median time of the last few recoveries (of any level), in us
+  uint32_t getMedianMicros();
+  void clearStats();
+
+private:
+  // Returns the step actually taken, which can be cheaper or dearer
+  RecoveryLevel step(RecoveryLevel level);
+
+  GP22 &_tdc;
+  uint8_t _failuresPerLevel;
+
+  bool _recovering;
+  uint8_t _level;
+  uint8_t _failuresAtLevel;
+  uint8_t _lastStep;
+  uint32_t _recoveryStart;
+
+  GP22RecoveryStats _stats[RECOVERY_LEVELS];
+  // The last few recovery times, for the median
+  uint32_t _recent[GP22_RECOVERY_RECENT];
+  uint8_t _recentCount;
+  uint8_t _recentNext;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "GP22Scheduler.h"
+#include "string.h"
+
+// Is time a before time b? Done as a signed difference so it wraps safely.
+static bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+GP22Scheduler::GP22Scheduler(GP22Clock clock) {
+  _clock = clock;
+  _numJobs = 0;
+  _loader = NULL;
+  _loaderContext = NULL;
+  _configLoaded = false;
+  _configLoads = 0;
+}
+
+int8_t GP22Scheduler::addJob(GP22JobFunction function, void * context, uint32_t period, uint32_t deadline,
+                             const uint32_t * config, bool startNow) {
+  if (_numJobs >= GP22_SCHEDULER_MAX_JOBS || function == NULL || period == 0)
+    return -1;
+
+  Job &job = _jobs[_numJobs];
+  job.function = function;
+  job.context = context;
+  job.config = config;
+  job.period = period;
+  // A deadline of 0 means the end of the period
+  job.deadline = deadline > 0 ? deadline : period;
+  job.nextRelease = _clock() + (startNow ? 0 : period);
+  job.absoluteDeadline = 0;
+  job.pending = false;
+  job.runs = 0;
+  job.fails = 0;
+  job.misses = 0;
+
+  return _numJobs++;
+}
+
+void GP22Scheduler::setConfigLoader(GP22ConfigLoader loader, void * context) {
+  _loader = loader;
+  _loaderContext = context;
+}
+void GP22Scheduler::invalidateConfig() {
+  _configLoaded = false;
+}
+
+void GP22Scheduler::release(uint32_t now) {
+  for (uint8_t i = 0; i < _numJobs; i++) {
+    Job &job = _jobs[i];
+    // Catch up on every release that has gone by
+    while (!before(now, job.nextRelease)) {
+      if (job.pending) {
+        // The last one never got to run, drop it in favour of this one.
+        job.misses++;
+      }
+      job.pending = true;
+      job.absoluteDeadline = job.nextRelease + job.deadline;
+      job.nextRelease += job.period;
+    }
+  }
+}
+
+bool GP22Scheduler::runNext() {
+  uint32_t now = _clock();
+  release(now);
+
+  // Find the released job with the earliest deadline
+  int8_t next = -1;
+  for (uint8_t i = 0; i < _numJobs; i++) {
+    if (!_jobs[i].pending)
+      continue;
+    if (next < 0 || before(_jobs[i].absoluteDeadline, _jobs[next].absoluteDeadline))
+      next = i;
+  }
+  if (next < 0)
+    return false;
+
+  Job &job = _jobs[next];
+  job.pending = false;
+
+  // Only swap the config over if this job needs a different one
+  if (job.config != NULL && (!_configLoaded ||
+      memcmp(job.config, _loadedConfig, sizeof(_loadedConfig)) != 0)) {
+    if (_loader)
+      _loader(job.config, _loaderContext);
+    memcpy(_loadedConfig, job.config, sizeof(_loadedConfig));
+    _configLoaded = true;
+    _configLoads++;
+  }
+
+  if (!job.function(job.context))
+    job.fails++;
+  job.runs++;
+
+  if (before(job.absoluteDeadline, _clock()))
+    job.misses++;
+
+  return true;
+}
+
+uint32_t GP22Scheduler::timeToNextRelease() {
+  uint32_t now = _clock();
+  uint32_t shortest = UINT32_MAX;
+
+  for (uint8_t i = 0; i < _numJobs; i++) {
+    if (_jobs[i].pending || !before(now, _jobs[i].nextRelease))
+      return 0;
+    uint32_t wait = _jobs[i].nextRelease - now;
+    if (wait < shortest)
+      shortest = wait;
+  }
+
+  return shortest;
+}
+
+uint8_t GP22Scheduler::getNumJobs() {
+  return _numJobs;
+}
+uint32_t GP22Scheduler::getRunCount(int8_t job) {
+  if (job >= 0 && job < _numJobs)
+    return _jobs[job].runs;
+  else
+    return 0;
+}
+uint32_t GP22Scheduler::getFailCount(int8_t job) {
+  if (job >= 0 && job < _numJobs)
+    return _jobs[job].fails;
+  else
+    return 0;
+}
+uint32_t GP22Scheduler::getMissCount(int8_t job) {
+  if (job >= 0 && job < _numJobs)
+    return _jobs[job].misses;
+  else
+    return 0;
+}
+uint32_t GP22Scheduler::getConfigLoadCount() {
+  return _configLoads;
+}
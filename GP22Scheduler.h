@@ -0,0 +1,93 @@
+#ifndef GP22Scheduler_h
+#define GP22Scheduler_h
+
+#include "stdint.h"
+#include "stddef.h"
+
+// The most jobs the scheduler can hold
+#define GP22_SCHEDULER_MAX_JOBS 8
+// The number of 32 bit registers in a config image
+#define GP22_SCHEDULER_CONFIG_WORDS 7
+
+// A job returns false if it failed (it still counts as having run)
+typedef bool (*GP22JobFunction)(void * context);
+// Loads a 7 register config image onto the chip, e.g. with
+// GP22::setConfig() then GP22::updateConfig()
+typedef void (*GP22ConfigLoader)(const uint32_t * image, void * context);
+// The time now, in any unit (e.g. micros() or a virtual clock for testing)
+typedef uint32_t (*GP22Clock)();
+
+// An earliest deadline first scheduler for periodic GP22 jobs, such as TOF
+// shots, temperature reads and recalibration.
+// Each job is released once per period and has to finish within its relative
+// deadline. Of the released jobs, the one with the earliest deadline runs
+// next, so a slow but rare job like a calibration can't be starved.
+//
+// Jobs can carry a config image. It is only loaded onto the chip when the
+// job to run needs a different image from the one that is already there.
+// The images are compared by content (against a copy of the last one
+// loaded), so jobs can share an image or have their own copies of it, and
+// an image that is changed in place gets loaded again.
+//
+// There is nothing GP22 (or Arduino) specific in here, so it can be tested
+// on a PC with a virtual clock (see extras/linux/gp22_scheduler_sim.cpp).
+// Times wrap around safely.
+class GP22Scheduler
+{
+public:
+  GP22Scheduler(GP22Clock clock);
+
+  // Add a periodic job, the first release is one period from now, or right
+  // away if startNow is set. Returns the job id, or -1 if there is no room.
+  // A config of NULL means the job doesn't care what is loaded.
+  int8_t addJob(GP22JobFunction function, void * context, uint32_t period, uint32_t deadline,
+                const uint32_t * config = NULL, bool startNow = true);
+  void setConfigLoader(GP22ConfigLoader loader, void * context);
+  // Forget which config is loaded, so the next job that has one loads it.
+  // Call this if the chip config was changed behind the scheduler's back.
+  void invalidateConfig();
+
+  // Release any jobs that are due and run the one with the earliest
+  // deadline. Returns false if there was nothing to run.
+  bool runNext();
+  // How long until the next job is released (0 if one is already waiting)
+  uint32_t timeToNextRelease();
+
+  uint8_t getNumJobs();
+  uint32_t getRunCount(int8_t job);
+  uint32_t getFailCount(int8_t job);
+  // Jobs that finished after their deadline, or were released again before
+  // they had run at all
+  uint32_t getMissCount(int8_t job);
+  uint32_t getConfigLoadCount();
+
+private:
+  struct Job {
+    GP22JobFunction function;
+    void * context;
+    const uint32_t * config;
+    uint32_t period;
+    uint32_t deadline;
+    uint32_t nextRelease;
+    uint32_t absoluteDeadline;
+    bool pending;
+    uint32_t runs;
+    uint32_t fails;
+    uint32_t misses;
+  };
+
+  void release(uint32_t now);
+
+  GP22Clock _clock;
+  Job _jobs[GP22_SCHEDULER_MAX_JOBS];
+  uint8_t _numJobs;
+
+  GP22ConfigLoader _loader;
+  void * _loaderContext;
+  // A copy of what was last loaded, if anything has been
+  uint32_t _loadedConfig[GP22_SCHEDULER_CONFIG_WORDS];
+  bool _configLoaded;
+  uint32_t _configLoads;
+};
+
+#endif
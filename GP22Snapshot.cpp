@@ -0,0 +1,51 @@
+#include "GP22Snapshot.h"
+#include "GP22Crc.h"
+#include "stddef.h"
+
+uint16_t GP22Snapshot::calculateCrc() {
+  return gp22Crc16((const uint8_t *)this, offsetof(GP22Snapshot, _crc));
+}
+
+void GP22Snapshot::capture(GP22 &tdc, GP22Kalman * kalman, GP22INL * inl) {
+  // Clear it first so the padding is the same every time, for the CRC
+  uint8_t * bytes = (uint8_t *)this;
+  for (size_t i = 0; i < sizeof(GP22Snapshot); i++)
+    bytes[i] = 0;
+
+  _magic = GP22_SNAPSHOT_MAGIC;
+  _version = GP22_SNAPSHOT_VERSION;
+  _size = sizeof(GP22Snapshot);
+
+  tdc.saveState(_tdc);
+  _haveKalman = kalman != NULL;
+  if (kalman)
+    kalman->getState(_kalman);
+  _haveINL = inl != NULL;
+  if (inl)
+    inl->getTable(_inl);
+
+  _crc = calculateCrc();
+}
+
+bool GP22Snapshot::isValid() {
+  return _magic == GP22_SNAPSHOT_MAGIC && _version == GP22_SNAPSHOT_VERSION &&
+    _size == sizeof(GP22Snapshot) && _crc == calculateCrc();
+}
+
+bool GP22Snapshot::restore(GP22 &tdc, GP22Kalman * kalman, GP22INL * inl) {
+  if (!isValid()) {
+    tdc.begin();
+    return false;
+  }
+
+  if (kalman && _haveKalman)
+    kalman->setState(_kalman);
+  if (inl && _haveINL)
+    inl->setTable(_inl);
+
+  return tdc.resume(_tdc);
+}
+
+void GP22Snapshot::invalidate() {
+  _magic = 0;
+}
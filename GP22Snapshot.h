@@ -0,0 +1,61 @@
+#ifndef GP22Snapshot_h
+#define GP22Snapshot_h
+
+#include "stdint.h"
+#include "GP22.h"
+#include "GP22Kalman.h"
+#include "GP22INL.h"
+
+#define GP22_SNAPSHOT_MAGIC 0x47503232UL // "GP22"
+// Bump this whenever the layout changes, so old snapshots aren't used
+#define GP22_SNAPSHOT_VERSION 1
+
+// Everything needed to carry on measuring after the MCU is reset (brown out,
+// watchdog, ...), so the first measurement after the reset is a good one:
+// the driver state (config image, conversion factors), the INL calibration
+// and the filter state.
+//
+// It's plain data, so it can be kept in RAM that isn't cleared at startup,
+// e.g. with GCC:
+//   GP22Snapshot snapshot __attribute__((section(".noinit")));
+// or copied byte for byte to flash or EEPROM. A magic number, version, size
+// and CRC are checked before any of it is used, so garbage after a power
+// cycle (or an old layout) just means a normal begin().
+//
+// The calibration and filter are optional, pass NULL to leave them out.
+class GP22Snapshot
+{
+public:
+  // Save everything and seal it with the CRC. Do this after every
+  // measurement (or every so often) so the snapshot is fresh.
+  void capture(GP22 &tdc, GP22Kalman * kalman, GP22INL * inl);
+
+  // Is there a good snapshot?
+  bool isValid();
+
+  // Put everything back and resume() the chip. Returns false if there was
+  // no good snapshot (and then begin() has been called instead) or the chip
+  // had to be set up again. The calibration and filter are only restored
+  // from a good snapshot.
+  bool restore(GP22 &tdc, GP22Kalman * kalman, GP22INL * inl);
+
+  // Make sure the snapshot isn't used, e.g. after a config change that
+  // should start from scratch.
+  void invalidate();
+
+private:
+  uint16_t calculateCrc();
+
+  uint32_t _magic;
+  uint16_t _version;
+  uint16_t _size;
+  GP22State _tdc;
+  bool _haveKalman;
+  GP22KalmanState _kalman;
+  bool _haveINL;
+  int16_t _inl[GP22_INL_BINS];
+  // This has to stay last, it covers everything above
+  uint16_t _crc;
+};
+
+#endif
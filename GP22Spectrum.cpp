@@ -0,0 +1,282 @@
+#include "GP22Spectrum.h"
+
+// The tables are Q15, generated with:
+//   cos/sin(2 * pi * k / N) for k < N / 2, and the periodic Hann window
+//   0.5 * (1 - cos(2 * pi * n / N)), for N = 256.
+static const int16_t cosTable[] = {
+  32767, 32758, 32729, 32679, 32610, 32522, 32413, 32286, 32138, 31972, 31786, 31581,
+  31357, 31114, 30853, 30572, 30274, 29957, 29622, 29269, 28899, 28511, 28106, 27684,
+  27246, 26791, 26320, 25833, 25330, 24812, 24279, 23732, 23170, 22595, 22006, 21403,
+  20788, 20160, 19520, 18868, 18205, 17531, 16846, 16151, 15447, 14733, 14010, 13279,
+  12540, 11793, 11039, 10279, 9512, 8740, 7962, 7180, 6393, 5602, 4808, 4011,
+  3212, 2411, 1608, 804, 0, -804, -1608, -2411, -3212, -4011, -4808, -5602,
+  -6393, -7180, -7962, -8740, -9512, -10279, -11039, -11793, -12540, -13279, -14010, -14733,
+  -15447, -16151, -16846, -17531, -18205, -18868, -19520, -20160, -20788, -21403, -22006, -22595,
+  -23170, -23732, -24279, -24812, -25330, -25833, -26320, -26791, -27246, -27684, -28106, -28511,
+  -28899, -29269, -29622, -29957, -30274, -30572, -30853, -31114, -31357, -31581, -31786, -31972,
+  -32138, -32286, -32413, -32522, -32610, -32679, -32729, -32758
+};
+
+static const int16_t sinTable[] = {
+  0, 804, 1608, 2411, 3212, 4011, 4808, 5602, 6393, 7180, 7962, 8740,
+  9512, 10279, 11039, 11793, 12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+  18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595, 23170, 23732, 24279, 24812,
+  25330, 25833, 26320, 26791, 27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+  30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972, 32138, 32286, 32413, 32522,
+  32610, 32679, 32729, 32758, 32767, 32758, 32729, 32679, 32610, 32522, 32413, 32286,
+  32138, 31972, 31786, 31581, 31357, 31114, 30853, 30572, 30274, 29957, 29622, 29269,
+  28899, 28511, 28106, 27684, 27246, 26791, 26320, 25833, 25330, 24812, 24279, 23732,
+  23170, 22595, 22006, 21403, 20788, 20160, 19520, 18868, 18205, 17531, 16846, 16151,
+  15447, 14733, 14010, 13279, 12540, 11793, 11039, 10279, 9512, 8740, 7962, 7180,
+  6393, 5602, 4808, 4011, 3212, 2411, 1608, 804
+};
+
+static const int16_t hannTable[] = {
+  0, 5, 20, 44, 79, 123, 177, 241, 315, 398, 491, 593,
+  705, 827, 958, 1098, 1247, 1406, 1573, 1749, 1935, 2128, 2331, 2542,
+  2761, 2989, 3224, 3468, 3719, 3978, 4244, 4518, 4799, 5087, 5381, 5682,
+  5990, 6304, 6624, 6950, 7282, 7619, 7961, 8308, 8661, 9018, 9379, 9745,
+  10114, 10487, 10864, 11245, 11628, 12014, 12403, 12794, 13188, 13583, 13980, 14378,
+  14778, 15179, 15580, 15982, 16384, 16786, 17188, 17589, 17990, 18390, 18788, 19185,
+  19580, 19974, 20365, 20754, 21140, 21523, 21904, 22281, 22654, 23023, 23389, 23750,
+  24107, 24460, 24807, 25149, 25486, 25818, 26144, 26464, 26778, 27086, 27387, 27681,
+  27969, 28250, 28524, 28790, 29049, 29300, 29544, 29779, 30007, 30226, 30437, 30640,
+  30833, 31019, 31195, 31362, 31521, 31670, 31810, 31941, 32063, 32175, 32277, 32370,
+  32453, 32527, 32591, 32645, 32689, 32724, 32748, 32763, 32767, 32763, 32748, 32724,
+  32689, 32645, 32591, 32527, 32453, 32370, 32277, 32175, 32063, 31941, 31810, 31670,
+  31521, 31362, 31195, 31019, 30833, 30640, 30437, 30226, 30007, 29779, 29544, 29300,
+  29049, 28790, 28524, 28250, 27969, 27681, 27387, 27086, 26778, 26464, 26144, 25818,
+  25486, 25149, 24807, 24460, 24107, 23750, 23389, 23023, 22654, 22281, 21904, 21523,
+  21140, 20754, 20365, 19974, 19580, 19185, 18788, 18390, 17990, 17589, 17188, 16786,
+  16384, 15982, 15580, 15179, 14778, 14378, 13980, 13583, 13188, 12794, 12403, 12014,
+  11628, 11245, 10864, 10487, 10114, 9745, 9379, 9018, 8661, 8308, 7961, 7619,
+  7282, 6950, 6624, 6304, 5990, 5682, 5381, 5087, 4799, 4518, 4244, 3978,
+  3719, 3468, 3224, 2989, 2761, 2542, 2331, 2128, 1935, 1749, 1573, 1406,
+  1247, 1098, 958, 827, 705, 593, 491, 398, 315, 241, 177, 123,
+  79, 44, 20, 5
+};
+
+static uint32_t squareRoot(uint32_t value) {
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > value)
+    bit >>= 2;
+  while (bit) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+GP22Spectrum::GP22Spectrum(uint32_t sampleRate) {
+  _sampleRate = sampleRate;
+  _hop = GP22_SPECTRUM_SIZE / 4;
+  _minAmplitude = 0;
+  clear();
+}
+
+void GP22Spectrum::setSampleRate(uint32_t sampleRate) {
+  _sampleRate = sampleRate;
+}
+void GP22Spectrum::setHop(uint16_t hop) {
+  if (hop < 1)
+    hop = 1;
+  if (hop > GP22_SPECTRUM_SIZE)
+    hop = GP22_SPECTRUM_SIZE;
+  _hop = hop;
+}
+void GP22Spectrum::setMinAmplitude(uint32_t amplitude) {
+  _minAmplitude = amplitude;
+}
+
+void GP22Spectrum::clear() {
+  _next = 0;
+  _filled = 0;
+  _sinceLast = 0;
+  _shift = 0;
+  _numPeaks = 0;
+  for (uint16_t i = 0; i < GP22_SPECTRUM_SIZE / 2; i++)
+    _magnitudes[i] = 0;
+}
+
+bool GP22Spectrum::add(int32_t raw) {
+  _window[_next] = raw;
+  _next = (_next + 1) & (GP22_SPECTRUM_SIZE - 1);
+  if (_filled < GP22_SPECTRUM_SIZE)
+    _filled++;
+  _sinceLast++;
+
+  if (_filled < GP22_SPECTRUM_SIZE || _sinceLast < _hop)
+    return false;
+  _sinceLast = 0;
+  analyse();
+  return true;
+}
+
+void GP22Spectrum::analyse() {
+  // Take the mean off, the TOF itself is of no interest here
+  int64_t sum = 0;
+  for (uint16_t i = 0; i < GP22_SPECTRUM_SIZE; i++)
+    sum += _window[i];
+  int32_t mean = (int32_t)(sum / GP22_SPECTRUM_SIZE);
+
+  uint64_t largest = 0;
+  for (uint16_t i = 0; i < GP22_SPECTRUM_SIZE; i++) {
+    int64_t deviation = (int64_t)_window[i] - mean;
+    uint64_t size = deviation < 0 ? -deviation : deviation;
+    if (size > largest)
+      largest = size;
+  }
+  // Block floating point: shift so the largest sample uses 14 bits, down
+  // for big swings and up for small ones. Otherwise a modulation of a few
+  // tens of LSBs is truncated away by the >> 1 of each butterfly stage.
+  _shift = 0;
+  while ((largest >> _shift) > 16383)
+    _shift++;
+  while (largest > 0 && _shift > -16 && (largest << -_shift) <= 8191)
+    _shift--;
+
+  // The window starts at the oldest sample
+  for (uint16_t i = 0; i < GP22_SPECTRUM_SIZE; i++) {
+    int64_t deviation = (int64_t)_window[(_next + i) & (GP22_SPECTRUM_SIZE - 1)] - mean;
+    int32_t sample = (int32_t)(_shift >= 0 ? deviation >> _shift : deviation * ((int64_t)1 << -_shift));
+    _re[i] = (int16_t)((sample * hannTable[i]) >> 15);
+    _im[i] = 0;
+  }
+
+  fft();
+
+  // With the 1/N scaling of the stages and the Hann window's gain of a half,
+  // a sinusoid of amplitude A comes out at A / 4 in its bin
+  // (at the FFT's scale, so the block exponent is undone here)
+  for (uint16_t k = 0; k < GP22_SPECTRUM_SIZE / 2; k++) {
+    uint64_t magnitude = fftMagnitude(k);
+    if (_shift >= 0) {
+      // Scaled back up this can need more than 32 bits, so saturate
+      magnitude <<= _shift;
+    } else {
+      // Round to the nearest LSB
+      magnitude = (magnitude + ((uint64_t)1 << (-_shift - 1))) >> -_shift;
+    }
+    _magnitudes[k] = magnitude > UINT32_MAX ? UINT32_MAX : (uint32_t)magnitude;
+  }
+
+  findPeaks();
+}
+
+void GP22Spectrum::fft() {
+  // Bit reversed reordering
+  for (uint16_t i = 1, j = 0; i < GP22_SPECTRUM_SIZE; i++) {
+    uint16_t bit = GP22_SPECTRUM_SIZE >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if (i < j) {
+      int16_t re = _re[i];
+      _re[i] = _re[j];
+      _re[j] = re;
+      int16_t im = _im[i];
+      _im[i] = _im[j];
+      _im[j] = im;
+    }
+  }
+
+  // The butterflies, halving at each stage so nothing overflows
+  for (uint16_t size = 2; size <= GP22_SPECTRUM_SIZE; size <<= 1) {
+    uint16_t half = size >> 1;
+    uint16_t step = GP22_SPECTRUM_SIZE / size;
+    for (uint16_t start = 0; start < GP22_SPECTRUM_SIZE; start += size) {
+      for (uint16_t j = 0; j < half; j++) {
+        // W = cos - j sin
+        int32_t wr = cosTable[j * step];
+        int32_t wi = -sinTable[j * step];
+        uint16_t a = start + j;
+        uint16_t b = a + half;
+
+        int32_t tr = (wr * _re[b] - wi * _im[b]) >> 15;
+        int32_t ti = (wr * _im[b] + wi * _re[b]) >> 15;
+        int32_t ar = _re[a];
+        int32_t ai = _im[a];
+
+        _re[a] = (int16_t)((ar + tr) >> 1);
+        _im[a] = (int16_t)((ai + ti) >> 1);
+        _re[b] = (int16_t)((ar - tr) >> 1);
+        _im[b] = (int16_t)((ai - ti) >> 1);
+      }
+    }
+  }
+}
+
+uint32_t GP22Spectrum::fftMagnitude(uint16_t bin) {
+  uint32_t power = (int32_t)_re[bin] * _re[bin] + (int32_t)_im[bin] * _im[bin];
+  return squareRoot(power) * 4;
+}
+
+void GP22Spectrum::findPeaks() {
+  _numPeaks = 0;
+
+  // Local maxima, leaving out DC (and what's left of it next door)
+  for (uint16_t k = 2; k < GP22_SPECTRUM_SIZE / 2 - 1; k++) {
+    uint32_t b = _magnitudes[k];
+    if (b <= _magnitudes[k - 1] || b < _magnitudes[k + 1] || b < _minAmplitude || b == 0)
+      continue;
+
+    // Find where it goes in the list, strongest first
+    uint8_t slot = _numPeaks;
+    while (slot > 0 && _peaks[slot - 1].amplitude < b)
+      slot--;
+    if (slot >= GP22_SPECTRUM_PEAKS)
+      continue;
+    if (_numPeaks < GP22_SPECTRUM_PEAKS)
+      _numPeaks++;
+    for (uint8_t i = _numPeaks - 1; i > slot; i--)
+      _peaks[i] = _peaks[i - 1];
+
+    // Fit a parabola through the bin and its neighbours for the true
+    // centre, in 1/256ths of a bin. This is done at the FFT's scale, where
+    // small peaks still have all their bits.
+    int32_t a = fftMagnitude(k - 1);
+    int32_t c = fftMagnitude(k + 1);
+    int32_t centre = fftMagnitude(k);
+    int32_t curvature = a - 2 * centre + c;
+    int32_t offset = curvature != 0 ? (128 * (a - c)) / curvature : 0;
+
+    _peaks[slot].frequency = (uint32_t)((((uint64_t)k * 256 + offset) * _sampleRate) / (GP22_SPECTRUM_SIZE * 256ULL));
+    _peaks[slot].amplitude = b;
+  }
+}
+
+uint8_t GP22Spectrum::getNumPeaks() {
+  return _numPeaks;
+}
+GP22Peak GP22Spectrum::getPeak(uint8_t n) {
+  if (n < _numPeaks)
+    return _peaks[n];
+  else
+    return GP22Peak();
+}
+
+uint32_t GP22Spectrum::getAveragingPeriod(uint32_t minMicros) {
+  if (_numPeaks == 0 || _peaks[0].frequency == 0)
+    return minMicros;
+  // 10^9 us mHz in a cycle
+  uint64_t period = 1000000000ULL / _peaks[0].frequency;
+  if (period == 0)
+    return minMicros;
+  uint64_t cycles = (minMicros + period - 1) / period;
+  if (cycles == 0)
+    cycles = 1;
+  return (uint32_t)(cycles * period);
+}
+
+uint32_t GP22Spectrum::getMagnitude(uint16_t bin) {
+  if (bin < GP22_SPECTRUM_SIZE / 2)
+    return _magnitudes[bin];
+  else
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef GP22Spectrum_h
+#define GP22Spectrum_h
+
+#include "stdint.h"
+
+// The FFT length. The tables in GP22Spectrum.cpp are for this size only.
+#define GP22_SPECTRUM_BITS 8
+#define GP22_SPECTRUM_SIZE (1 << GP22_SPECTRUM_BITS)
+// How many of the strongest peaks are reported
+#define GP22_SPECTRUM_PEAKS 4
+
+// A spectral peak
+struct GP22Peak {
+  // In mHz, interpolated between the bins
+  uint32_t frequency;
+  // The amplitude of the modulation, in raw result LSBs
+  uint32_t amplitude;
+};
+
+// Finds periodic modulation (pump pulsation, pipe vibration, ...) in a
+// stream of raw results, so that the averaging can be matched to it.
+//
+// The results go into a sliding window, and every hop samples the window
+// is Hann windowed and run through a fixed point radix-2 FFT. The mean is
+// taken off and the samples are shifted down to fit 15 bits first (so it
+// works whatever the TOF is), and each FFT stage is scaled by a half so
+// it can't overflow. The twiddle and window tables are precomputed consts
+// (in flash on the Due). The strongest local maxima of the spectrum are
+// then reported with their frequency and amplitude.
+class GP22Spectrum
+{
+public:
+  // sampleRate is how many results a second are added, in mHz
+  GP22Spectrum(uint32_t sampleRate);
+
+  // The rate the results are added at, in mHz
+  void setSampleRate(uint32_t sampleRate);
+  // How many new samples between each FFT (1 to GP22_SPECTRUM_SIZE)
+  void setHop(uint16_t hop);
+  // Peaks smaller than this (raw LSBs) are not reported
+  void setMinAmplitude(uint32_t amplitude);
+
+  // Forget the window and the peaks
+  void clear();
+
+  // Add a raw result. Returns true if a new spectrum was worked out.
+  bool add(int32_t raw);
+
+  // How many peaks the last spectrum had, strongest first
+  uint8_t getNumPeaks();
+  GP22Peak getPeak(uint8_t n);
+
+  // The shortest averaging period of at least minMicros that covers a
+  // whole number of cycles of the strongest peak (minMicros if there is none).
+  uint32_t getAveragingPeriod(uint32_t minMicros);
+
+  // The magnitude of a bin of the last spectrum, in raw LSBs of amplitude
+  uint32_t getMagnitude(uint16_t bin);
+
+private:
+  void analyse();
+  void fft();
+  void findPeaks();
+  // A bin's magnitude at the FFT's own scale, for the peak fit
+  uint32_t fftMagnitude(uint16_t bin);
+
+  uint32_t _sampleRate;
+  uint16_t _hop;
+  uint32_t _minAmplitude;
+
+  int32_t _window[GP22_SPECTRUM_SIZE];
+  uint16_t _next;
+  uint16_t _filled;
+  uint16_t _sinceLast;
+
+  int16_t _re[GP22_SPECTRUM_SIZE];
+  int16_t _im[GP22_SPECTRUM_SIZE];
+  // The block exponent: the samples were scaled down by 2^_shift (or up, if
+  // it's negative) to fill the FFT's 16 bits
+  int8_t _shift;
+  uint32_t _magnitudes[GP22_SPECTRUM_SIZE / 2];
+
+  GP22Peak _peaks[GP22_SPECTRUM_PEAKS];
+  uint8_t _numPeaks;
+};
+
+#endif
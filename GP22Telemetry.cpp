@@ -0,0 +1,111 @@
+#include "GP22Telemetry.h"
+#include "Arduino.h"
+
+#define GP22_TELEMETRY_MASK (GP22_TELEMETRY_BUFFER - 1)
+// A full compiler and hardware memory barrier (DMB on ARM)
+#define GP22_BARRIER() __sync_synchronize()
+
+GP22Telemetry::GP22Telemetry(Print &out) : _out(out) {
+  _head = 0;
+  _tail = 0;
+  _dropped = 0;
+  _droppedSent = 0;
+  _batchSize = GP22_TELEMETRY_MAX_RECORDS;
+  _flushTime = 10000;
+  _waiting = false;
+  _waitingSince = 0;
+  _sequence = 0;
+}
+
+bool GP22Telemetry::push(int32_t result, uint16_t status) {
+  uint16_t head = _head;
+  // The indices run freely and wrap, the difference is the fill level.
+  if ((uint16_t)(head - _tail) >= GP22_TELEMETRY_BUFFER) {
+    _dropped++;
+    return false;
+  }
+
+  _results[head & GP22_TELEMETRY_MASK] = result;
+  _statuses[head & GP22_TELEMETRY_MASK] = status;
+  // Only publish the record once it has been written
+  GP22_BARRIER();
+  _head = head + 1;
+  return true;
+}
+
+bool GP22Telemetry::poll() {
+  uint16_t count = (uint16_t)(_head - _tail);
+
+  if (count == 0) {
+    _waiting = false;
+    return false;
+  }
+  if (!_waiting) {
+    _waiting = true;
+    _waitingSince = micros();
+  }
+
+  if (count >= _batchSize || (micros() - _waitingSince) >= _flushTime) {
+    sendFrame(count >= _batchSize ? _batchSize : count);
+    return true;
+  }
+  return false;
+}
+
+void GP22Telemetry::flush() {
+  uint16_t count;
+  while ((count = (uint16_t)(_head - _tail)) > 0)
+    sendFrame(count >= _batchSize ? _batchSize : count);
+}
+
+void GP22Telemetry::sendFrame(uint8_t count) {
+  uint32_t dropped = _dropped;
+
+  _frame[0] = GP22_TELEMETRY_VERSION;
+  _frame[1] = count;
+  gp22PutLE16(_frame + 2, _sequence);
+  gp22PutLE32(_frame + 4, _waitingSince);
+  gp22PutLE16(_frame + 8, (uint16_t)(dropped - _droppedSent));
+  _droppedSent = dropped;
+
+  uint8_t * record = _frame + GP22_TELEMETRY_HEADER_SIZE;
+  uint16_t tail = _tail;
+  // Don't read the records before the head that published them
+  GP22_BARRIER();
+  for (uint8_t i = 0; i < count; i++) {
+    gp22PutLE32(record, (uint32_t)_results[tail & GP22_TELEMETRY_MASK]);
+    gp22PutLE16(record + 4, _statuses[tail & GP22_TELEMETRY_MASK]);
+    record += GP22_TELEMETRY_RECORD_SIZE;
+    tail++;
+  }
+  // The records are copied out, so the space can be reused
+  GP22_BARRIER();
+  _tail = tail;
+
+  size_t length = record - _frame;
+  gp22PutLE16(record, gp22Crc16(_frame, length));
+  length += 2;
+
+  // One write per frame, so the USB stack can send it as a bulk transfer
+  size_t encoded = gp22CobsEncode(_frame, length, _encoded);
+  _out.write(_encoded, encoded);
+
+  _sequence++;
+  // Anything left over starts waiting from now
+  _waitingSince = micros();
+}
+
+void GP22Telemetry::setFlushTime(uint32_t micros) {
+  _flushTime = micros;
+}
+void GP22Telemetry::setBatchSize(uint8_t records) {
+  if (records >= 1 && records <= GP22_TELEMETRY_MAX_RECORDS)
+    _batchSize = records;
+}
+
+uint16_t GP22Telemetry::getSequence() {
+  return _sequence;
+}
+uint32_t GP22Telemetry::getDroppedCount() {
+  return _dropped;
+}
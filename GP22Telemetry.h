@@ -0,0 +1,62 @@
+#ifndef GP22Telemetry_h
+#define GP22Telemetry_h
+
+#include "stdint.h"
+#include "Print.h"
+#include "GP22TelemetryFormat.h"
+
+// How many records the ring buffer holds (must be a power of 2)
+#define GP22_TELEMETRY_BUFFER 256
+
+// Streams raw results and status words out in binary frames, e.g. over the
+// Due's native USB port (SerialUSB). See GP22TelemetryFormat.h for the format.
+//
+// The acquisition side (a loop or an ISR) push()es into a ring buffer, and
+// poll() from the main loop packs the buffer into a frame and writes it out
+// in one go once there is a full frame, or once the oldest record has been
+// waiting for the flush time. There is one producer and one consumer, so
+// the ring needs no locking.
+class GP22Telemetry
+{
+public:
+  GP22Telemetry(Print &out);
+
+  // Queue up a measurement. Returns false (and counts it) if the buffer is full.
+  bool push(int32_t result, uint16_t status);
+
+  // Send a frame if one is due. Returns true if a frame went out.
+  bool poll();
+  // Send whatever is in the buffer now.
+  void flush();
+
+  // How long the oldest record can wait before a part frame is sent, in us
+  void setFlushTime(uint32_t micros);
+  // How many records make a full frame (1 to GP22_TELEMETRY_MAX_RECORDS)
+  void setBatchSize(uint8_t records);
+
+  uint16_t getSequence();
+  uint32_t getDroppedCount();
+
+private:
+  void sendFrame(uint8_t count);
+
+  Print &_out;
+
+  int32_t _results[GP22_TELEMETRY_BUFFER];
+  uint16_t _statuses[GP22_TELEMETRY_BUFFER];
+  volatile uint16_t _head;
+  volatile uint16_t _tail;
+  volatile uint32_t _dropped;
+  uint32_t _droppedSent;
+
+  uint8_t _batchSize;
+  uint32_t _flushTime;
+  bool _waiting;
+  uint32_t _waitingSince;
+  uint16_t _sequence;
+
+  uint8_t _frame[GP22_TELEMETRY_MAX_FRAME];
+  uint8_t _encoded[GP22_TELEMETRY_MAX_ENCODED];
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef GP22TelemetryFormat_h
+#define GP22TelemetryFormat_h
+
+#include "stdint.h"
+#include "stddef.h"
+#include "GP22Crc.h"
+
+// The binary telemetry frame format, shared by the sender on the target
+// (GP22Telemetry) and the receivers on the PC (extras/linux).
+//
+// Before framing, a frame is (all little endian):
+//   version (1), record count (1), sequence (2), timestamp in us (4),
+//   records dropped since the last frame (2),
+//   count * { raw result (4), status (2) },
+//   CRC-16 of everything before it (2)
+// This is then COBS encoded and ends with a 0x00 delimiter. A full frame is
+// kept under 254 bytes, so COBS only ever adds a single byte.
+#define GP22_TELEMETRY_VERSION 1
+#define GP22_TELEMETRY_HEADER_SIZE 10
+#define GP22_TELEMETRY_RECORD_SIZE 6
+#define GP22_TELEMETRY_MAX_RECORDS 40
+#define GP22_TELEMETRY_MAX_FRAME (GP22_TELEMETRY_HEADER_SIZE + GP22_TELEMETRY_MAX_RECORDS * GP22_TELEMETRY_RECORD_SIZE + 2)
+// The most an encoded frame (with its delimiter) can take up
+#define GP22_TELEMETRY_MAX_ENCODED (GP22_TELEMETRY_MAX_FRAME + 2)
+
+// A decoded frame. The records are left where they are in the buffer.
+struct GP22TelemetryFrame {
+  uint8_t count;
+  uint16_t sequence;
+  uint32_t timestamp;
+  uint16_t dropped;
+  const uint8_t * records;
+};
+
+inline void gp22PutLE16(uint8_t * out, uint16_t value) {
+  out[0] = value;
+  out[1] = value >> 8;
+}
+inline void gp22PutLE32(uint8_t * out, uint32_t value) {
+  out[0] = value;
+  out[1] = value >> 8;
+  out[2] = value >> 16;
+  out[3] = value >> 24;
+}
+inline uint16_t gp22GetLE16(const uint8_t * in) {
+  return (uint16_t)in[0] | ((uint16_t)in[1] << 8);
+}
+inline uint32_t gp22GetLE32(const uint8_t * in) {
+  return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// The raw result and status of the n-th record of a frame
+inline int32_t gp22TelemetryResult(const GP22TelemetryFrame &frame, uint8_t n) {
+  return (int32_t)gp22GetLE32(frame.records + n * GP22_TELEMETRY_RECORD_SIZE);
+}
+inline uint16_t gp22TelemetryStatus(const GP22TelemetryFrame &frame, uint8_t n) {
+  return gp22GetLE16(frame.records + n * GP22_TELEMETRY_RECORD_SIZE + 4);
+}
+
+// COBS encode length bytes into out (which must have room for length + 2),
+// including the 0x00 delimiter. Returns the encoded length.
+inline size_t gp22CobsEncode(const uint8_t * in, size_t length, uint8_t * out) {
+  size_t codePos = 0;
+  size_t outPos = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < length; i++) {
+    if (in[i] == 0) {
+      out[codePos] = code;
+      codePos = outPos++;
+      code = 1;
+    } else {
+      out[outPos++] = in[i];
+      code++;
+      if (code == 0xFF) {
+        out[codePos] = code;
+        codePos = outPos++;
+        code = 1;
+      }
+    }
+  }
+  out[codePos] = code;
+  out[outPos++] = 0;
+
+  return outPos;
+}
+
+// COBS decode in place (the delimiter should not be included). Decoding only
+// ever shrinks the data, so no copy is needed. Returns the decoded length,
+// or 0 if the data is not valid COBS.
+inline size_t gp22CobsDecodeInPlace(uint8_t * data, size_t length) {
+  size_t inPos = 0;
+  size_t outPos = 0;
+
+  while (inPos < length) {
+    uint8_t code = data[inPos++];
+    if (code == 0 || inPos + code - 1 > length)
+      return 0;
+    for (uint8_t i = 1; i < code; i++) {
+      if (data[inPos] == 0)
+        return 0;
+      data[outPos++] = data[inPos++];
+    }
+    if (code < 0xFF && inPos < length)
+      data[outPos++] = 0;
+  }
+
+  return outPos;
+}
+
+// Decode a frame in place, given the bytes between two delimiters.
+// Returns false if it is damaged.
+inline bool gp22TelemetryDecode(uint8_t * data, size_t length, GP22TelemetryFrame &frame) {
+  size_t decoded = gp22CobsDecodeInPlace(data, length);
+  if (decoded < GP22_TELEMETRY_HEADER_SIZE + 2)
+    return false;
+  if (data[0] != GP22_TELEMETRY_VERSION)
+    return false;
+
+  frame.count = data[1];
+  if (decoded != (size_t)GP22_TELEMETRY_HEADER_SIZE + frame.count * GP22_TELEMETRY_RECORD_SIZE + 2)
+    return false;
+  if (gp22Crc16(data, decoded - 2) != gp22GetLE16(data + decoded - 2))
+    return false;
+
+  frame.sequence = gp22GetLE16(data + 2);
+  frame.timestamp = gp22GetLE32(data + 4);
+  frame.dropped = gp22GetLE16(data + 8);
+  frame.records = data + GP22_TELEMETRY_HEADER_SIZE;
+  return true;
+}
+
+#endif
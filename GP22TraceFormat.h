@@ -0,0 +1,101 @@
+#ifndef GP22TraceFormat_h
+#define GP22TraceFormat_h
+
+#include "stdint.h"
+#include "stddef.h"
+#include "GP22TelemetryFormat.h"
+#include "GP22Crc.h"
+
+// The binary dump format of the SPI flight recorder, shared by the target
+// (GP22Recorder) and the decoder on the PC (extras/linux).
+//
+// All little endian:
+//   magic "GPTR" (4), version (1), record size (1), record count (2),
+//   cycle counter rate in Hz, 0 if unknown (4), records lost to wrapping (4),
+//   count * record, oldest first:
+//     cycles (4), source (1), opcode (1), data length (1), flags (1),
+//     bytes sent after the opcode (4), bytes received (4)
+//   CRC-16 of everything before it (2)
+// The data bytes are in the order they went over the wire, only the first
+// length of them mean anything.
+
+#define GP22_TRACE_MAGIC "GPTR"
+#define GP22_TRACE_VERSION 1
+#define GP22_TRACE_HEADER 16
+#define GP22_TRACE_RECORD 16
+
+struct GP22TraceRecord {
+  uint32_t cycles;
+  uint8_t source;
+  uint8_t opcode;
+  uint8_t length;
+  uint8_t flags;
+  uint8_t tx[4];
+  uint8_t rx[4];
+};
+
+struct GP22TraceHeader {
+  uint16_t count;
+  uint32_t clockHz;
+  uint32_t lost;
+};
+
+inline void gp22TraceEncodeHeader(uint8_t * out, const GP22TraceHeader &header) {
+  for (uint8_t i = 0; i < 4; i++)
+    out[i] = GP22_TRACE_MAGIC[i];
+  out[4] = GP22_TRACE_VERSION;
+  out[5] = GP22_TRACE_RECORD;
+  gp22PutLE16(out + 6, header.count);
+  gp22PutLE32(out + 8, header.clockHz);
+  gp22PutLE32(out + 12, header.lost);
+}
+
+inline void gp22TraceEncodeRecord(uint8_t * out, const GP22TraceRecord &record) {
+  gp22PutLE32(out, record.cycles);
+  out[4] = record.source;
+  out[5] = record.opcode;
+  out[6] = record.length;
+  out[7] = record.flags;
+  for (uint8_t i = 0; i < 4; i++) {
+    out[8 + i] = record.tx[i];
+    out[12 + i] = record.rx[i];
+  }
+}
+
+// Check a whole dump and read its header. Returns false if it is damaged,
+// truncated or from another version.
+inline bool gp22TraceDecodeHeader(const uint8_t * data, size_t length, GP22TraceHeader &header) {
+  if (length < GP22_TRACE_HEADER + 2)
+    return false;
+  for (uint8_t i = 0; i < 4; i++) {
+    if (data[i] != (uint8_t)GP22_TRACE_MAGIC[i])
+      return false;
+  }
+  if (data[4] != GP22_TRACE_VERSION || data[5] != GP22_TRACE_RECORD)
+    return false;
+
+  header.count = gp22GetLE16(data + 6);
+  header.clockHz = gp22GetLE32(data + 8);
+  header.lost = gp22GetLE32(data + 12);
+
+  size_t body = GP22_TRACE_HEADER + (size_t)header.count * GP22_TRACE_RECORD;
+  if (length < body + 2)
+    return false;
+  return gp22GetLE16(data + body) == gp22Crc16(data, body);
+}
+
+// The n-th record of a dump that has passed gp22TraceDecodeHeader()
+inline void gp22TraceDecodeRecord(const uint8_t * data, uint16_t n, GP22TraceRecord &record) {
+  const uint8_t * in = data + GP22_TRACE_HEADER + (size_t)n * GP22_TRACE_RECORD;
+  record.cycles = gp22GetLE32(in);
+  record.source = in[4];
+  record.opcode = in[5];
+  record.length = in[6];
+  record.flags = in[7];
+  for (uint8_t i = 0; i < 4; i++) {
+    record.tx[i] = in[8 + i];
+    record.rx[i] = in[12 + i];
+  }
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "GP22Transport.h"
+
+GP22SPITransport::GP22SPITransport(SPIClass &spi) : _spi(spi) {
+}
+
+void GP22SPITransport::begin(int ssPin) {
+  _spi.begin(ssPin);
+  //Run the SPI clock at 14 MHz (GP22's max is apparently 20 MHz)
+  _spi.setClockDivider(ssPin, 6);
+  //Clock polarity = 0, clock phase = 1 (MODE1?)
+  _spi.setDataMode(ssPin, SPI_MODE1);
+  //The GP22 sends the most significant bit first
+  _spi.setBitOrder(ssPin, MSBFIRST);
+}
+
+uint8_t GP22SPITransport::transfer(int ssPin, uint8_t byte, bool last) {
+  return _spi.transfer(ssPin, byte, last ? SPI_LAST : SPI_CONTINUE);
+}
+
+void GP22SPITransport::end() {
+  _spi.end();
+}
+
+GP22Transport &gp22DefaultTransport() {
+  // Made on first use, so it doesn't depend on the order SPI is set up in
+  static GP22SPITransport transport(SPI);
+  return transport;
+}
+
+#if defined(ARDUINO_ARCH_SAM)
+
+GP22UsartTransport::GP22UsartTransport(Usart * usart, uint32_t peripheralId, int txPin, int rxPin, int sckPin,
+    EPioType sckPeripheral) {
+  _usart = usart;
+  _peripheralId = peripheralId;
+  _txPin = txPin;
+  _rxPin = rxPin;
+  _sckPin = sckPin;
+  _sckPeripheral = sckPeripheral;
+  _selected = false;
+}
+
+void GP22UsartTransport::begin(int ssPin) {
+  pinMode(ssPin, OUTPUT);
+  digitalWrite(ssPin, HIGH);
+
+  // Only the first chip needs to set the USART itself up
+  if (pmc_is_periph_clk_enabled(_peripheralId))
+    return;
+  pmc_enable_periph_clk(_peripheralId);
+
+  const int pins[3] = { _txPin, _rxPin, _sckPin };
+  const EPioType peripherals[3] = { PIO_PERIPH_A, PIO_PERIPH_A, _sckPeripheral };
+  for (uint8_t i = 0; i < 3; i++) {
+    PIO_Configure(g_APinDescription[pins[i]].pPort, peripherals[i],
+      g_APinDescription[pins[i]].ulPin, PIO_DEFAULT);
+  }
+
+  _usart->US_CR = US_CR_RSTRX | US_CR_RSTTX | US_CR_RXDIS | US_CR_TXDIS;
+  // SPI master, 8 bit, clock out on SCK. Mode 1 (CPOL = 0, data captured
+  // on the falling edge) is CPHA = 0 here, as the USART's CPHA is the
+  // other way round from SPI's. MSB first is the default in SPI mode.
+  _usart->US_MR = US_MR_USART_MODE_SPI_MASTER | US_MR_USCLKS_MCK |
+    US_MR_CHRL_8_BIT | US_MR_CHMODE_NORMAL | US_MR_CLKO;
+  // 84 MHz / 6 = 14 MHz, the same as on SPI0
+  _usart->US_BRGR = 6;
+  _usart->US_CR = US_CR_RXEN | US_CR_TXEN;
+}
+
+uint8_t GP22UsartTransport::transfer(int ssPin, uint8_t byte, bool last) {
+  if (!_selected) {
+    digitalWrite(ssPin, LOW);
+    _selected = true;
+  }
+
+  while ((_usart->US_CSR & US_CSR_TXRDY) == 0) {}
+  _usart->US_THR = byte;
+  while ((_usart->US_CSR & US_CSR_RXRDY) == 0) {}
+  uint8_t received = _usart->US_RHR;
+
+  if (last) {
+    digitalWrite(ssPin, HIGH);
+    _selected = false;
+  }
+  return received;
+}
+
+void GP22UsartTransport::end() {
+  _usart->US_CR = US_CR_RXDIS | US_CR_TXDIS;
+  pmc_disable_periph_clk(_peripheralId);
+}
+
+#endif
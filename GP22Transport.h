@@ -0,0 +1,76 @@
+#ifndef GP22Transport_h
+#define GP22Transport_h
+
+#include "stdint.h"
+#include "SPI.h"
+
+// The SPI controller a GP22 (or a bus of them) is talked to through, so
+// that chips can be put on controllers other than the Due's SPI0: a USART
+// in SPI mode (GP22UsartTransport), a Linux spidev node
+// (extras/linux/GP22SpidevTransport.h), or anything else that can do
+// mode 1, MSB first, with the chip select held over a frame.
+class GP22Transport
+{
+public:
+  virtual ~GP22Transport() {}
+
+  // Set the controller up for the chip on this select pin. This is called
+  // again whenever a chip takes a shared bus over, so it should be cheap
+  // to repeat.
+  virtual void begin(int ssPin) = 0;
+  // Swap one byte. The select stays asserted until a byte with last set.
+  virtual uint8_t transfer(int ssPin, uint8_t byte, bool last) = 0;
+  // Shut the controller down. Only whoever owns it should call this.
+  virtual void end() = 0;
+};
+
+// The Arduino SPI library's controller (SPI0 on the Due), with its
+// per-pin settings and hardware chip selects.
+class GP22SPITransport : public GP22Transport
+{
+public:
+  GP22SPITransport(SPIClass &spi);
+
+  void begin(int ssPin);
+  uint8_t transfer(int ssPin, uint8_t byte, bool last);
+  void end();
+
+private:
+  SPIClass &_spi;
+};
+
+// The transport used by chips that aren't on a bus: SPI through GP22SPITransport
+GP22Transport &gp22DefaultTransport();
+
+#if defined(ARDUINO_ARCH_SAM)
+
+// One of the Due's USARTs in SPI master mode, as an extra SPI controller.
+// The TXD (MOSI), RXD (MISO) and SCK pins are Arduino pin numbers, e.g. for
+// USART1 (Serial2): 16, 17 and A0 (PA16), all peripheral A:
+//   GP22UsartTransport usart(USART1, ID_USART1, 16, 17, A0);
+// USART0's SCK (PA17, SDA1) is on peripheral B, so pass PIO_PERIPH_B for it.
+// The chip selects are plain GPIOs, driven by hand so they can be held over
+// a whole frame.
+class GP22UsartTransport : public GP22Transport
+{
+public:
+  GP22UsartTransport(Usart * usart, uint32_t peripheralId, int txPin, int rxPin, int sckPin,
+    EPioType sckPeripheral = PIO_PERIPH_A);
+
+  void begin(int ssPin);
+  uint8_t transfer(int ssPin, uint8_t byte, bool last);
+  void end();
+
+private:
+  Usart * _usart;
+  uint32_t _peripheralId;
+  int _txPin;
+  int _rxPin;
+  int _sckPin;
+  EPioType _sckPeripheral;
+  bool _selected;
+};
+
+#endif
+
+#endif
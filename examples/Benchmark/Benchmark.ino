@@ -0,0 +1,30 @@
+// Measures the CPU cost of the library's conversion, config and filter code
+// on the target, and prints the results as JSON over the serial port.
+// The same benchmarks can be run on a PC with extras/linux/gp22_bench.
+//
+// On the Due the timing is done with the DWT cycle counter, so the results
+// are in 84 MHz clock cycles. Nothing needs to be connected to the GP22,
+// but readStatus() then times an SPI transfer to nowhere.
+
+#include <SPI.h>
+#include "GP22.h"
+#include "GP22Bench.h"
+#include "BenchmarkCases.h"
+
+// The GP22 chip select pin
+#define GP22_SS 52
+
+GP22 tdc(GP22_SS);
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) {}
+
+  tdc.begin();
+
+  GP22Bench bench(Serial);
+  runBenchmarks(bench, tdc);
+}
+
+void loop() {
+}
@@ -0,0 +1,100 @@
+#ifndef BenchmarkCases_h
+#define BenchmarkCases_h
+
+// The benchmarks themselves, shared by the sketch (on the target) and
+// extras/linux/gp22_bench.cpp (on a PC), so the numbers compare directly.
+
+#include "GP22.h"
+#include "GP22Bench.h"
+#include "GP22Kalman.h"
+#include "GP22INL.h"
+
+struct BenchmarkContext {
+  GP22 * tdc;
+  GP22Kalman * kalman;
+  GP22INL * inl;
+  int32_t input;
+  // Results go here so they aren't optimised away
+  volatile float output;
+  volatile int32_t rawOutput;
+};
+
+static void benchMeasConv(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  c->output = c->tdc->measConv(c->input++);
+}
+
+static void benchUpdateConversionFactors(void * context) {
+  // Changing the pre-divider is what recalculates the factors
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  c->tdc->setClkPreDiv(c->input++ & 1 ? 2 : 1);
+}
+
+static void benchSetFirstWaveOffset(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  c->tdc->setFirstWaveOffset((c->input++ % 72) - 36);
+}
+
+static void benchSetFirstWaveDelays(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  uint8_t stop1 = 3 + (c->input++ & 15);
+  c->tdc->setFirstWaveDelays(stop1, stop1 + 10, stop1 + 20);
+}
+
+static void benchSetStopMask(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  c->tdc->setStopMask(1, c->input++ & 0x7FFFF);
+}
+
+static void benchGetConfig(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  uint32_t config[7];
+  c->tdc->getConfig(config);
+  c->rawOutput = config[c->input++ % 7];
+}
+
+static void benchKalman(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  // A slowly moving TOF with a bit of noise
+  c->input++;
+  c->kalman->update((200L << 16) + c->input * 3 + (c->input * 7919 & 255));
+  c->rawOutput = c->kalman->getEstimate();
+}
+
+static void benchINLCorrect(void * context) {
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  c->rawOutput = c->inl->correct(c->input);
+  c->input += 40503;
+}
+
+static void benchReadStatus(void * context) {
+  // Includes the bus time on the target, only the CPU side on a PC
+  BenchmarkContext * c = (BenchmarkContext *)context;
+  c->tdc->readStatus();
+  c->rawOutput = c->tdc->getStatus();
+}
+
+// Run them all, with the output going wherever the bench was set up to
+inline void runBenchmarks(GP22Bench &bench, GP22 &tdc) {
+  GP22Kalman kalman(10, 40000);
+  GP22INL inl;
+  BenchmarkContext context;
+  context.tdc = &tdc;
+  context.kalman = &kalman;
+  context.inl = &inl;
+  context.input = 12345678;
+
+  bench.begin();
+  bench.run("measConv", benchMeasConv, &context, 100);
+  bench.run("updateConversionFactors", benchUpdateConversionFactors, &context, 20);
+  bench.run("setFirstWaveOffset", benchSetFirstWaveOffset, &context, 100);
+  bench.run("setFirstWaveDelays", benchSetFirstWaveDelays, &context, 100);
+  bench.run("setStopMask", benchSetStopMask, &context, 100);
+  bench.run("getConfig", benchGetConfig, &context, 100);
+  bench.run("GP22Kalman::update", benchKalman, &context, 100);
+  bench.run("GP22INL::correct", benchINLCorrect, &context, 100);
+  bench.run("readStatus", benchReadStatus, &context, 20);
+  bench.end();
+}
+
+#endif
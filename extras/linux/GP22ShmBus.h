@@ -0,0 +1,258 @@
+#ifndef GP22ShmBus_h
+#define GP22ShmBus_h
+
+// A shared memory measurement bus for Linux, so several processes (logger,
+// controller, UI, ...) can all follow the same GP22 data stream.
+//
+// There is one writer (the process driving the chip) and any number of
+// readers. The data lives in a POSIX shared memory ring; the writer never
+// waits on or even knows about the readers, and publishing is a few plain
+// stores, so there are no syscalls per sample. Each reader has its own
+// cursor, and every slot carries a sequence number so a reader that falls
+// more than a ring behind finds out how many records it lost (and skips to
+// the oldest one still there) rather than reading torn data.
+//
+// Header only, needs C++11 and -lrt on older glibc. In the acquisition loop:
+//   GP22ShmWriter bus;
+//   bus.create("/gp22", 65536);
+//   ...
+//   GP22ShmRecord record = { result, status, 0, generation, nowNs };
+//   bus.publish(record);
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define GP22_SHM_MAGIC 0x47503232 // "GP22"
+#define GP22_SHM_VERSION 1
+
+struct GP22ShmRecord {
+  int32_t result;
+  uint16_t status;
+  uint16_t flags;
+  uint32_t configGeneration;
+  uint64_t timestampNs;
+};
+
+// What is actually in shared memory. The record is split over atomic words
+// so readers and the writer can touch a slot at the same time safely.
+struct GP22ShmSlot {
+  std::atomic<uint64_t> sequence;
+  std::atomic<uint64_t> resultStatus;
+  std::atomic<uint64_t> generation;
+  std::atomic<uint64_t> timestamp;
+};
+
+struct GP22ShmHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t slotSize;
+  // The index of the next record to be written
+  std::atomic<uint64_t> writeIndex;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == 8, "atomics must be plain words to be shared");
+
+inline size_t gp22ShmSize(uint32_t capacity) {
+  return sizeof(GP22ShmHeader) + (size_t)capacity * sizeof(GP22ShmSlot);
+}
+
+class GP22ShmWriter
+{
+public:
+  GP22ShmWriter() : _header(NULL), _slots(NULL), _size(0), _index(0), _mask(0) {}
+  ~GP22ShmWriter() { close(); }
+
+  // Create (or replace) the named ring. The capacity must be a power of 2.
+  bool create(const char * name, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+      return false;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+      return false;
+    _size = gp22ShmSize(capacity);
+    if (ftruncate(fd, _size) != 0) {
+      ::close(fd);
+      return false;
+    }
+    void * memory = mmap(NULL, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+      return false;
+
+    // Start from scratch. Readers check the magic last, so they won't
+    // attach to a half set up ring.
+    memset(memory, 0, _size);
+    _header = (GP22ShmHeader *)memory;
+    _slots = (GP22ShmSlot *)(_header + 1);
+    _header->version = GP22_SHM_VERSION;
+    _header->capacity = capacity;
+    _header->slotSize = sizeof(GP22ShmSlot);
+    _header->writeIndex.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _header->magic = GP22_SHM_MAGIC;
+
+    _index = 0;
+    _mask = capacity - 1;
+    return true;
+  }
+
+  void close() {
+    if (_header)
+      munmap(_header, _size);
+    _header = NULL;
+    _slots = NULL;
+  }
+
+  // Add a record to the ring. Readers that are a whole ring behind lose
+  // their oldest record, the writer never waits.
+  void publish(const GP22ShmRecord &record) {
+    GP22ShmSlot &slot = _slots[_index & _mask];
+
+    // An odd sequence marks the slot as being written
+    slot.sequence.store(2 * _index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.resultStatus.store((uint32_t)record.result | ((uint64_t)record.status << 32) | ((uint64_t)record.flags << 48),
+                            std::memory_order_relaxed);
+    slot.generation.store(record.configGeneration, std::memory_order_relaxed);
+    slot.timestamp.store(record.timestampNs, std::memory_order_relaxed);
+
+    slot.sequence.store(2 * _index + 2, std::memory_order_release);
+    _index++;
+    _header->writeIndex.store(_index, std::memory_order_release);
+  }
+
+  uint64_t getWriteIndex() { return _index; }
+
+private:
+  GP22ShmHeader * _header;
+  GP22ShmSlot * _slots;
+  size_t _size;
+  uint64_t _index;
+  uint64_t _mask;
+};
+
+class GP22ShmReader
+{
+public:
+  GP22ShmReader() : _header(NULL), _slots(NULL), _size(0), _cursor(0), _mask(0), _lost(0) {}
+  ~GP22ShmReader() { close(); }
+
+  // Attach to a ring. New readers start from the newest record, unless
+  // fromOldest is set, in which case they get everything still in the ring.
+  bool open(const char * name, bool fromOldest = false) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+      return false;
+
+    // Map the header first to find out how big the whole thing is
+    GP22ShmHeader * header = (GP22ShmHeader *)mmap(NULL, sizeof(GP22ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+    if (header == MAP_FAILED) {
+      ::close(fd);
+      return false;
+    }
+    bool valid = header->magic == GP22_SHM_MAGIC && header->version == GP22_SHM_VERSION
+        && header->slotSize == sizeof(GP22ShmSlot);
+    uint32_t capacity = header->capacity;
+    munmap(header, sizeof(GP22ShmHeader));
+    if (!valid) {
+      ::close(fd);
+      return false;
+    }
+
+    _size = gp22ShmSize(capacity);
+    void * memory = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+      return false;
+
+    _header = (GP22ShmHeader *)memory;
+    _slots = (GP22ShmSlot *)(_header + 1);
+    _mask = capacity - 1;
+    _lost = 0;
+
+    uint64_t written = _header->writeIndex.load(std::memory_order_acquire);
+    if (fromOldest)
+      _cursor = written > capacity ? written - capacity : 0;
+    else
+      _cursor = written;
+    return true;
+  }
+
+  void close() {
+    if (_header)
+      munmap(_header, _size);
+    _header = NULL;
+    _slots = NULL;
+  }
+
+  // Get the next record. Returns false if there is nothing new.
+  bool read(GP22ShmRecord &record) {
+    while (true) {
+      uint64_t written = _header->writeIndex.load(std::memory_order_acquire);
+      if (_cursor >= written)
+        return false;
+
+      // If we've been lapped, skip to the oldest record that is left.
+      uint64_t capacity = _mask + 1;
+      if (written - _cursor > capacity) {
+        _lost += written - capacity - _cursor;
+        _cursor = written - capacity;
+      }
+
+      const GP22ShmSlot &slot = _slots[_cursor & _mask];
+      uint64_t expected = 2 * _cursor + 2;
+      uint64_t before = slot.sequence.load(std::memory_order_acquire);
+      uint64_t resultStatus = slot.resultStatus.load(std::memory_order_relaxed);
+      uint64_t generation = slot.generation.load(std::memory_order_relaxed);
+      uint64_t timestamp = slot.timestamp.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+      if (before != expected || after != expected) {
+        // The writer has lapped us and is reusing this slot, so this
+        // record has gone. Count it and move on to the next one.
+        if (before > expected || after > expected) {
+          _lost++;
+          _cursor++;
+          continue;
+        }
+        // Not written yet, which can't happen once writeIndex has moved on,
+        // but don't hand out junk if it does.
+        return false;
+      }
+
+      record.result = (int32_t)(uint32_t)resultStatus;
+      record.status = (uint16_t)(resultStatus >> 32);
+      record.flags = (uint16_t)(resultStatus >> 48);
+      record.configGeneration = (uint32_t)generation;
+      record.timestampNs = timestamp;
+      _cursor++;
+      return true;
+    }
+  }
+
+  // How many records this reader has missed by falling too far behind
+  uint64_t getLostCount() { return _lost; }
+  // How many records are waiting to be read
+  uint64_t getBacklog() {
+    return _header->writeIndex.load(std::memory_order_acquire) - _cursor;
+  }
+
+private:
+  GP22ShmHeader * _header;
+  const GP22ShmSlot * _slots;
+  size_t _size;
+  uint64_t _cursor;
+  uint64_t _mask;
+  uint64_t _lost;
+};
+
+#endif
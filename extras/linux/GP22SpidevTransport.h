@@ -0,0 +1,107 @@
+#ifndef GP22SpidevTransport_h
+#define GP22SpidevTransport_h
+
+// A GP22Transport on a Linux spidev controller (Raspberry Pi, BeagleBone,
+// ...), so the library can drive chips from a Linux board directly:
+//   GP22SpidevTransport transport(0);   // /dev/spidev0.<chip select>
+//   GP22Bus bus(transport);
+//   GP22 tdc(1);                        // on /dev/spidev0.1
+//   tdc.setBus(&bus);
+//   tdc.begin();
+//   ...
+//   bus.end();
+//
+// The GP22's select pin is the spidev chip select number. Each byte is its
+// own ioctl, with cs_change set on all but the last byte of a frame so the
+// driver holds the select between them. That's a syscall a byte, which is
+// fine for the GP22's short frames.
+//
+// Header only, build with the host shim (-Iextras/linux/host).
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "GP22Transport.h"
+
+#define GP22_SPIDEV_MAX_SELECTS 4
+
+class GP22SpidevTransport : public GP22Transport
+{
+public:
+  GP22SpidevTransport(int bus, uint32_t speedHz = 14000000) {
+    _bus = bus;
+    _speedHz = speedHz;
+    for (int i = 0; i < GP22_SPIDEV_MAX_SELECTS; i++)
+      _fds[i] = -1;
+  }
+  ~GP22SpidevTransport() {
+    end();
+  }
+
+  // Opens the device on first use, it's left open until end()
+  void begin(int ssPin) {
+    if (ssPin < 0 || ssPin >= GP22_SPIDEV_MAX_SELECTS || _fds[ssPin] >= 0)
+      return;
+
+    char path[32];
+    snprintf(path, sizeof(path), "/dev/spidev%d.%d", _bus, ssPin);
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+      perror(path);
+      return;
+    }
+
+    uint8_t mode = SPI_MODE_1;
+    uint8_t bits = 8;
+    if (ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+        ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+        ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &_speedHz) < 0) {
+      perror(path);
+      close(fd);
+      return;
+    }
+    _fds[ssPin] = fd;
+  }
+
+  // Returns 0 if the device isn't open or the transfer fails
+  uint8_t transfer(int ssPin, uint8_t byte, bool last) {
+    if (ssPin < 0 || ssPin >= GP22_SPIDEV_MAX_SELECTS || _fds[ssPin] < 0)
+      return 0;
+
+    uint8_t received = 0;
+    struct spi_ioc_transfer xfer;
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)&byte;
+    xfer.rx_buf = (unsigned long)&received;
+    xfer.len = 1;
+    xfer.speed_hz = _speedHz;
+    xfer.bits_per_word = 8;
+    // On the last transfer of a message this keeps the select asserted
+    // into the next message, which is what we want until the frame ends
+    xfer.cs_change = last ? 0 : 1;
+
+    if (ioctl(_fds[ssPin], SPI_IOC_MESSAGE(1), &xfer) < 0)
+      return 0;
+    return received;
+  }
+
+  void end() {
+    for (int i = 0; i < GP22_SPIDEV_MAX_SELECTS; i++) {
+      if (_fds[i] >= 0) {
+        close(_fds[i]);
+        _fds[i] = -1;
+      }
+    }
+  }
+
+private:
+  int _bus;
+  uint32_t _speedHz;
+  int _fds[GP22_SPIDEV_MAX_SELECTS];
+};
+
+#endif
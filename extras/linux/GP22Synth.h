@@ -0,0 +1,168 @@
+#ifndef GP22Synth_h
+#define GP22Synth_h
+
+// A synthetic GP22 result stream for benchmarking everything downstream of
+// the chip (filters, statistics, logging, export) at far higher rates than a
+// real chip can give.
+//
+// The results are raw Q16.16 values as readResult() returns them, with
+// status words laid out as readStatus() reads them (read pointer in bits
+// 0-2, CH1 hits in 3-5, timeout in 9). The TOF is made up of:
+//   tof + drift * n + (flow step, on for every other 2^stepShift samples)
+//   + Gaussian jitter,
+// with a chance of each sample timing out, and some number of echoes per
+// shot, spaced echoSpacing apart (the first echo is in register 0).
+//
+// Sample n is a pure function of n and the seed, using a counter based
+// hash rather than a sequential RNG. So there is no dependency from one
+// sample to the next, the loop in generate() vectorises, any range can be
+// generated in any order, and several threads can generate one stream.
+// The counter is 32 bits, so the noise repeats every 2^32 samples.
+// The jitter is Irwin-Hall (the sum of four uniforms), which is close enough
+// to Gaussian for timing jitter and needs no transcendental functions.
+//
+// Header only. For example:
+//   GP22SynthConfig config = gp22SynthDefaults();
+//   config.jitter = 200;
+//   GP22Synth synth(config);
+//   synth.generate(0, 4096, results, statuses);
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct GP22SynthConfig {
+  // The mean TOF, raw Q16.16
+  int32_t tof;
+  // Standard deviation of the jitter, in raw LSBs
+  float jitter;
+  // How much the TOF changes per sample, in raw LSBs
+  float drift;
+  // The chance of a sample timing out (0 - 1)
+  float timeoutRate;
+  // The flow step, in raw LSBs (0 for none), and how often it toggles
+  // (every 2^stepShift samples, up to 31)
+  int32_t stepSize;
+  uint8_t stepShift;
+  // Echoes per shot (1 - 4), and how far apart they are, raw
+  uint8_t echoes;
+  int32_t echoSpacing;
+  uint64_t seed;
+};
+
+inline GP22SynthConfig gp22SynthDefaults() {
+  GP22SynthConfig config;
+  // About 50 us at 4 MHz
+  config.tof = 200 << 16;
+  config.jitter = 100;
+  config.drift = 0;
+  config.timeoutRate = 0;
+  config.stepSize = 0;
+  config.stepShift = 16;
+  config.echoes = 1;
+  config.echoSpacing = 40 << 16;
+  config.seed = 0;
+  return config;
+}
+
+// A 32 bit integer hash (lowbias32), good enough to use on a counter as an
+// RNG and only 32 bit multiplies, so it vectorises everywhere.
+inline uint32_t gp22SynthHash(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7FEB352DU;
+  x ^= x >> 15;
+  x *= 0x846CA68BU;
+  x ^= x >> 16;
+  return x;
+}
+
+class GP22Synth
+{
+public:
+  GP22Synth(const GP22SynthConfig &config) {
+    setConfig(config);
+  }
+
+  void setConfig(const GP22SynthConfig &config) {
+    _config = config;
+    if (_config.echoes < 1)
+      _config.echoes = 1;
+    if (_config.echoes > 4)
+      _config.echoes = 4;
+    // The sample counter is 32 bits, so a bigger shift is undefined
+    if (_config.stepShift > 31)
+      _config.stepShift = 31;
+    // Four uniform 16 bit values sum to a standard deviation of
+    // 65536 * sqrt(4 / 12)
+    _jitterScale = config.jitter / 37837.2f;
+    _timeoutThreshold = (uint32_t)(config.timeoutRate * 4294967295.0f);
+    if (config.timeoutRate >= 1.0f)
+      _timeoutThreshold = UINT32_MAX;
+    _key = gp22SynthHash((uint32_t)config.seed) ^ gp22SynthHash((uint32_t)(config.seed >> 32) + 0x9E3779B9U);
+    // Each echo is a CH1 hit with its own result register
+    _goodStatus = _config.echoes | (_config.echoes << 3);
+  }
+  const GP22SynthConfig &getConfig() const {
+    return _config;
+  }
+
+  // Fill in samples start to start + count - 1. The results are what
+  // register 0 would hold (the first echo).
+  void generate(uint64_t start, size_t count, int32_t * results, uint16_t * statuses) const {
+    // The drift is worked out in double at the block start and float within
+    // it, so it stays accurate however far into the stream the block is.
+    const size_t block = 4096;
+    for (size_t done = 0; done < count; done += block) {
+      size_t n = count - done < block ? count - done : block;
+      uint64_t first = start + done;
+      double base = _config.tof + (double)_config.drift * (double)first;
+      generateBlock((uint32_t)first, (float)(base - (int32_t)base), (int32_t)base, n, results + done, statuses + done);
+    }
+  }
+
+  // One sample's result in any register, e.g. for the later echoes.
+  int32_t result(uint64_t n, uint8_t reg) const {
+    int32_t results[1];
+    uint16_t statuses[1];
+    generate(n, 1, results, statuses);
+    if ((statuses[0] & 0x0600) || reg >= _config.echoes)
+      return 0;
+    return results[0] + reg * _config.echoSpacing;
+  }
+
+private:
+  void generateBlock(uint32_t first, float fraction, int32_t base, size_t count, int32_t * results, uint16_t * statuses) const {
+    const uint32_t key = _key;
+    const float jitterScale = _jitterScale;
+    const float drift = _config.drift;
+    const uint32_t threshold = _timeoutThreshold;
+    const int32_t stepSize = _config.stepSize;
+    const uint8_t stepShift = _config.stepShift;
+    const uint16_t goodStatus = _goodStatus;
+
+    // Kept branch free so that it vectorises
+    for (size_t i = 0; i < count; i++) {
+      uint32_t counter = first + (uint32_t)i;
+      uint32_t a = gp22SynthHash(counter ^ key);
+      uint32_t b = gp22SynthHash(a + 0x9E3779B9U);
+      uint32_t c = gp22SynthHash(b + 0x85EBCA6BU);
+
+      int32_t sum = (int32_t)(a & 0xFFFF) + (int32_t)(a >> 16) + (int32_t)(b & 0xFFFF) + (int32_t)(b >> 16) - 131070;
+      float offset = fraction + drift * (float)i + (float)sum * jitterScale;
+      int32_t step = ((counter >> stepShift) & 1) ? stepSize : 0;
+      int32_t value = base + step + (int32_t)offset;
+
+      bool timeout = c < threshold;
+      results[i] = timeout ? 0 : value;
+      // A timeout has nothing in the result registers and no hits
+      statuses[i] = timeout ? 0x0200 : goodStatus;
+    }
+  }
+
+  GP22SynthConfig _config;
+  float _jitterScale;
+  uint32_t _timeoutThreshold;
+  uint32_t _key;
+  uint16_t _goodStatus;
+};
+
+#endif
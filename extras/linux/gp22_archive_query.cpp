@@ -0,0 +1,238 @@
+// Queries a GP22Archive file: a summary of the whole file, the records in
+// a time range as CSV, or statistics over a time range. Only the index and
+// the blocks that overlap the range are read; blocks that are wholly inside
+// it are summed from the index without being decoded at all.
+//
+// Build: g++ -O2 -I../.. -o gp22_archive_query gp22_archive_query.cpp
+// Usage: gp22_archive_query archive.gpa                 (summary)
+//        gp22_archive_query -r <from> <to> archive.gpa  (records as CSV)
+//        gp22_archive_query -s <from> <to> archive.gpa  (statistics)
+// The times are in whatever units the logger used, from <= time <= to.
+//
+// If the file was never closed (no trailer), the blocks are found by
+// scanning it instead.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <algorithm>
+
+#include "GP22ArchiveFormat.h"
+
+struct Statistics {
+  uint64_t count;
+  uint64_t good;
+  int32_t min;
+  int32_t max;
+  // Sums of the good results and their squares, in long double so that a
+  // month of them still adds up exactly enough
+  long double sum;
+  long double squares;
+};
+
+static void addEntry(Statistics &stats, const GP22ArchiveIndexEntry &entry) {
+  stats.count += entry.count;
+  if (entry.good == 0)
+    return;
+  stats.good += entry.good;
+  stats.min = std::min(stats.min, entry.minResult);
+  stats.max = std::max(stats.max, entry.maxResult);
+  stats.sum += entry.sum;
+  // The block's squares are about its minimum, so move them to about zero
+  long double m = entry.minResult;
+  stats.squares += (long double)entry.sumSquares + 2 * m * entry.sum - entry.good * m * m;
+}
+
+static void addRecord(Statistics &stats, int32_t result, uint32_t status) {
+  stats.count++;
+  if (status & 0x0600)
+    return;
+  stats.good++;
+  stats.min = std::min(stats.min, result);
+  stats.max = std::max(stats.max, result);
+  stats.sum += result;
+  stats.squares += (long double)result * result;
+}
+
+static void printStatistics(const Statistics &stats) {
+  printf("records %llu, good %llu\n", (unsigned long long)stats.count, (unsigned long long)stats.good);
+  if (stats.good == 0)
+    return;
+  long double mean = stats.sum / stats.good;
+  long double variance = stats.squares / stats.good - mean * mean;
+  printf("result min %d, max %d, mean %.3Lf, sd %.3Lf (raw LSB)\n", stats.min, stats.max, mean, variance > 0 ? sqrtl(variance) : 0);
+}
+
+// Follow the index pages back from the trailer
+static bool readIndex(const uint8_t * data, size_t size, std::vector<GP22ArchiveIndexEntry> &index) {
+  if (size < GP22_ARCHIVE_FILE_HEADER + GP22_ARCHIVE_TRAILER)
+    return false;
+  const uint8_t * trailer = data + size - GP22_ARCHIVE_TRAILER;
+  if (memcmp(trailer + 12, "GPAT", 4) != 0)
+    return false;
+
+  uint64_t page = gp22GetLE64(trailer);
+  uint32_t blocks = gp22GetLE32(trailer + 8);
+  while (page != GP22_ARCHIVE_NO_PAGE) {
+    if (page + GP22_ARCHIVE_INDEX_HEADER > size || memcmp(data + page, "GPAI", 4) != 0)
+      return false;
+    const uint8_t * in = data + page;
+    uint16_t count = gp22GetLE16(in + 4);
+    size_t length = GP22_ARCHIVE_INDEX_HEADER + (size_t)count * GP22_ARCHIVE_INDEX_ENTRY;
+    if (page + length + 2 > size || gp22GetLE16(in + length) != gp22Crc16(in, length))
+      return false;
+
+    // The pages are newest first, so the entries go on backwards
+    for (int i = count - 1; i >= 0; i--) {
+      GP22ArchiveIndexEntry entry;
+      gp22ArchiveDecodeEntry(in + GP22_ARCHIVE_INDEX_HEADER + i * GP22_ARCHIVE_INDEX_ENTRY, entry);
+      index.push_back(entry);
+    }
+    page = gp22GetLE64(in + 8);
+  }
+
+  std::reverse(index.begin(), index.end());
+  return index.size() == blocks;
+}
+
+// No trailer, so find the blocks the slow way and index them here
+static void scanIndex(const uint8_t * data, size_t size, std::vector<GP22ArchiveIndexEntry> &index) {
+  static int64_t times[GP22_ARCHIVE_BLOCK_RECORDS];
+  static int32_t results[GP22_ARCHIVE_BLOCK_RECORDS];
+  static uint32_t statuses[GP22_ARCHIVE_BLOCK_RECORDS];
+  static uint32_t generations[GP22_ARCHIVE_BLOCK_RECORDS];
+
+  size_t offset = GP22_ARCHIVE_FILE_HEADER;
+  while (offset < size) {
+    size_t length = gp22ArchiveBlockSize(data + offset, size - offset);
+    uint16_t count = length ? gp22ArchiveDecodeBlock(data + offset, times, results, statuses, generations) : 0;
+    if (count == 0) {
+      // An index page, or damage, so move on a byte
+      offset++;
+      continue;
+    }
+
+    GP22ArchiveIndexEntry entry = GP22ArchiveIndexEntry();
+    entry.offset = offset;
+    entry.count = count;
+    entry.minTime = times[0];
+    entry.maxTime = times[count - 1];
+    entry.minResult = INT32_MAX;
+    entry.maxResult = INT32_MIN;
+    for (uint16_t i = 0; i < count; i++) {
+      if (statuses[i] & 0x0600)
+        continue;
+      entry.good++;
+      entry.sum += results[i];
+      entry.minResult = std::min(entry.minResult, results[i]);
+      entry.maxResult = std::max(entry.maxResult, results[i]);
+    }
+    for (uint16_t i = 0; i < count; i++) {
+      if (!(statuses[i] & 0x0600)) {
+        uint64_t difference = (int64_t)results[i] - entry.minResult;
+        entry.sumSquares += difference * difference;
+      }
+    }
+    index.push_back(entry);
+    offset += length;
+  }
+}
+
+int main(int argc, char ** argv) {
+  char mode = 0;
+  int64_t from = INT64_MIN;
+  int64_t to = INT64_MAX;
+  const char * path = NULL;
+
+  if (argc == 2) {
+    path = argv[1];
+  } else if (argc == 5 && (strcmp(argv[1], "-r") == 0 || strcmp(argv[1], "-s") == 0)) {
+    mode = argv[1][1];
+    from = strtoll(argv[2], NULL, 0);
+    to = strtoll(argv[3], NULL, 0);
+    path = argv[4];
+  } else {
+    fprintf(stderr, "usage: %s [-r|-s <from> <to>] <archive>\n", argv[0]);
+    return 1;
+  }
+
+  int fd = open(path, O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    perror(path);
+    return 1;
+  }
+  size_t size = info.st_size;
+  const uint8_t * data = (const uint8_t *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED || size < GP22_ARCHIVE_FILE_HEADER || memcmp(data, "GPAR", 4) != 0 || data[4] != GP22_ARCHIVE_VERSION) {
+    fprintf(stderr, "%s: not a version %d archive\n", path, GP22_ARCHIVE_VERSION);
+    return 1;
+  }
+
+  std::vector<GP22ArchiveIndexEntry> index;
+  if (!readIndex(data, size, index)) {
+    fprintf(stderr, "%s: no good index (not closed?), scanning\n", path);
+    index.clear();
+    scanIndex(data, size, index);
+  }
+
+  Statistics stats = { 0, 0, INT32_MAX, INT32_MIN, 0, 0 };
+  static int64_t times[GP22_ARCHIVE_BLOCK_RECORDS];
+  static int32_t results[GP22_ARCHIVE_BLOCK_RECORDS];
+  static uint32_t statuses[GP22_ARCHIVE_BLOCK_RECORDS];
+  static uint32_t generations[GP22_ARCHIVE_BLOCK_RECORDS];
+  size_t decoded = 0;
+
+  // The blocks are in time order, so skip straight to the first one that
+  // could be in the range
+  size_t first = std::lower_bound(index.begin(), index.end(), from,
+    [](const GP22ArchiveIndexEntry &entry, int64_t time) { return entry.maxTime < time; }) - index.begin();
+
+  if (mode == 'r')
+    printf("time,result,status,generation\n");
+
+  for (size_t b = first; b < index.size() && index[b].minTime <= to; b++) {
+    const GP22ArchiveIndexEntry &entry = index[b];
+
+    if (mode != 'r' && entry.minTime >= from && entry.maxTime <= to) {
+      addEntry(stats, entry);
+      continue;
+    }
+
+    size_t length = entry.offset < size ? gp22ArchiveBlockSize(data + entry.offset, size - entry.offset) : 0;
+    uint16_t count = length ? gp22ArchiveDecodeBlock(data + entry.offset, times, results, statuses, generations) : 0;
+    if (count == 0) {
+      fprintf(stderr, "%s: block at %llu is damaged, skipped\n", path, (unsigned long long)entry.offset);
+      continue;
+    }
+    decoded++;
+
+    for (uint16_t i = 0; i < count; i++) {
+      if (times[i] < from || times[i] > to)
+        continue;
+      if (mode == 'r')
+        printf("%lld,%d,%u,%u\n", (long long)times[i], results[i], statuses[i], generations[i]);
+      else
+        addRecord(stats, results[i], statuses[i]);
+    }
+  }
+
+  if (mode == 0 && !index.empty()) {
+    printf("%zu blocks, %llu bytes, times %lld to %lld\n", index.size(), (unsigned long long)size,
+      (long long)index.front().minTime, (long long)index.back().maxTime);
+  }
+  if (mode != 'r') {
+    printStatistics(stats);
+    printf("blocks decoded %zu\n", decoded);
+  }
+
+  munmap((void *)data, size);
+  close(fd);
+  return 0;
+}
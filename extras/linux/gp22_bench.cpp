@@ -0,0 +1,87 @@
+// Runs the library's CPU microbenchmarks (examples/Benchmark) on a PC and
+// prints the results as JSON, for comparing against the target and
+// checking optimisations.
+//
+// Build: g++ -O2 -std=c++17 -Ihost -I../.. -I../../examples/Benchmark -o gp22_bench gp22_bench.cpp
+//          ../../GP22.cpp ../../GP22Bus.cpp ../../GP22Transport.cpp ../../GP22Recorder.cpp ../../GP22Kalman.cpp
+//          ../../GP22INL.cpp ../../GP22Bench.cpp -lpthread
+// Usage: gp22_bench [-p] [-s samples]
+//   -p  count cycles with perf_event (the real core clock) rather than the TSC
+//   -s  timed samples per benchmark (default 31)
+//
+// Pin it to a core (taskset -c 2) and keep the machine quiet for steady
+// numbers. The TSC ticks at a fixed rate, whatever the core clock is doing,
+// so use -p where perf_event is allowed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "GP22.h"
+#include "GP22Bench.h"
+#include "BenchmarkCases.h"
+
+static int perfFd = -1;
+
+static uint32_t perfCycles() {
+  uint64_t count = 0;
+  if (read(perfFd, &count, sizeof(count)) != sizeof(count))
+    return 0;
+  return (uint32_t)count;
+}
+
+static bool openPerf() {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = PERF_COUNT_HW_CPU_CYCLES;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  perfFd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (perfFd < 0)
+    return false;
+  ioctl(perfFd, PERF_EVENT_IOC_RESET, 0);
+  ioctl(perfFd, PERF_EVENT_IOC_ENABLE, 0);
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  bool perf = false;
+  int samples = 31;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-p") == 0)
+      perf = true;
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      samples = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [-p] [-s samples]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  FilePrint out(stdout);
+  GP22Bench bench(out);
+  bench.setSamples(samples, 3);
+
+  if (perf) {
+    if (!openPerf()) {
+      perror("perf_event_open");
+      return 1;
+    }
+    // The core clock rate varies, so it's left as unknown
+    bench.setClock(perfCycles, 0);
+  }
+
+  GP22 tdc(0);
+  tdc.begin();
+  runBenchmarks(bench, tdc);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+// Runs GP22Scheduler against a virtual clock, with made up job and config
+// load times, to check a job mix fits before it goes near a chip. Time only
+// moves when a job or a config load "takes" it, or when the scheduler is
+// idle and skips ahead to the next release, so a long run takes no time.
+//
+// Build: g++ -O2 -I../.. -o gp22_scheduler_sim gp22_scheduler_sim.cpp ../../GP22Scheduler.cpp
+// Usage: gp22_scheduler_sim [-d seconds] [-w]
+//   -d  how long to simulate (default 60)
+//   -w  start with the clock just before it wraps around
+//
+// The job mix is a 1 kHz TOF shot in measurement mode 2, a temperature read
+// every 50 ms in its own config and a calibration every 2 s. The calibration
+// has its own copy of the TOF config, so it shouldn't cause a load. The
+// temperature read is longer than a TOF period, so some shots get dropped.
+//
+// It exits non-zero if the scheduler doesn't behave as expected: the config
+// loads must match, the temperature and calibration jobs must never miss,
+// and no more TOF shots may miss than the long jobs can account for.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GP22Scheduler.h"
+
+// Everything is in us
+#define TOF_PERIOD 1000
+#define TOF_TIME 120
+#define TEMP_PERIOD 50000
+#define TEMP_TIME 3000
+#define CAL_PERIOD 2000000
+#define CAL_TIME 15000
+#define CAL_DEADLINE 100000
+// Seven 4 byte register writes at 14 MHz, and the calls around them
+#define LOAD_TIME 40
+
+static uint32_t virtualNow = 0;
+static uint32_t clockNow() {
+  return virtualNow;
+}
+
+struct SimJob {
+  const char * name;
+  uint32_t time;
+};
+
+static bool runJob(void * context) {
+  virtualNow += ((SimJob *)context)->time;
+  return true;
+}
+
+static void loadConfig(const uint32_t *, void *) {
+  virtualNow += LOAD_TIME;
+}
+
+int main(int argc, char ** argv) {
+  uint32_t seconds = 60;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      seconds = atol(argv[++i]);
+    } else if (strcmp(argv[i], "-w") == 0) {
+      virtualNow = UINT32_MAX - 5000000;
+    } else {
+      fprintf(stderr, "Usage: %s [-d seconds] [-w]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // Register 0 differs in the measurement mode (and so does the ALU setup)
+  static const uint32_t tofConfig[GP22_SCHEDULER_CONFIG_WORDS] =
+    { 0x00242000, 0x21444000, 0x20000000, 0x18000000, 0x20000000, 0x10000000, 0x00000000 };
+  static const uint32_t tempConfig[GP22_SCHEDULER_CONFIG_WORDS] =
+    { 0x00042800, 0x21444000, 0x20000000, 0x18000000, 0x20000000, 0x10000000, 0x00000000 };
+  uint32_t calConfig[GP22_SCHEDULER_CONFIG_WORDS];
+  memcpy(calConfig, tofConfig, sizeof(calConfig));
+
+  SimJob jobs[3] = {
+    { "tof", TOF_TIME },
+    { "temperature", TEMP_TIME },
+    { "calibration", CAL_TIME }
+  };
+
+  GP22Scheduler scheduler(clockNow);
+  scheduler.setConfigLoader(loadConfig, NULL);
+  int8_t ids[3];
+  ids[0] = scheduler.addJob(runJob, &jobs[0], TOF_PERIOD, 0, tofConfig);
+  ids[1] = scheduler.addJob(runJob, &jobs[1], TEMP_PERIOD, 0, tempConfig);
+  ids[2] = scheduler.addJob(runJob, &jobs[2], CAL_PERIOD, CAL_DEADLINE, calConfig);
+
+  uint32_t start = virtualNow;
+  uint64_t busy = 0;
+  uint64_t elapsed = 0;
+  while (elapsed < (uint64_t)seconds * 1000000) {
+    uint32_t before = virtualNow;
+    if (scheduler.runNext())
+      busy += virtualNow - before;
+    else
+      virtualNow += scheduler.timeToNextRelease();
+    elapsed += virtualNow - before;
+  }
+
+  printf("%u s simulated from t = %u us, %.1f%% busy\n", seconds, start, 100.0 * busy / elapsed);
+  printf("%-12s %10s %8s %8s\n", "job", "runs", "misses", "fails");
+  for (uint8_t i = 0; i < 3; i++) {
+    printf("%-12s %10u %8u %8u\n", jobs[i].name, scheduler.getRunCount(ids[i]),
+      scheduler.getMissCount(ids[i]), scheduler.getFailCount(ids[i]));
+  }
+  int failed = 0;
+
+  // Two loads per temperature read (there and back), plus the first one
+  uint32_t loads = scheduler.getConfigLoadCount();
+  uint32_t expectedLoads = 2 * scheduler.getRunCount(ids[1]) + 1;
+  printf("config loads %u (expected %u)\n", loads, expectedLoads);
+  if (loads != expectedLoads) {
+    printf("FAIL: config loads\n");
+    failed = 1;
+  }
+
+  // The long jobs have slack to spare, so they should never miss
+  for (uint8_t i = 1; i < 3; i++) {
+    if (scheduler.getMissCount(ids[i]) != 0) {
+      printf("FAIL: %s missed\n", jobs[i].name);
+      failed = 1;
+    }
+  }
+
+  // A TOF shot can only be lost while a long job (and its loads) holds the
+  // chip, one for every TOF period that job takes
+  uint32_t tofMisses = scheduler.getMissCount(ids[0]);
+  uint32_t maxTofMisses = scheduler.getRunCount(ids[1]) * ((TEMP_TIME + 2 * LOAD_TIME) / TOF_PERIOD + 1) +
+    scheduler.getRunCount(ids[2]) * (CAL_TIME / TOF_PERIOD + 1);
+  printf("tof misses %u (at most %u)\n", tofMisses, maxTofMisses);
+  if (tofMisses > maxTofMisses) {
+    printf("FAIL: tof misses\n");
+    failed = 1;
+  }
+
+  // Every release either runs or is counted as missed
+  uint32_t releases = (uint32_t)(elapsed / TOF_PERIOD);
+  if (scheduler.getRunCount(ids[0]) + tofMisses + 1 < releases) {
+    printf("FAIL: tof releases lost (%u of %u accounted for)\n",
+      scheduler.getRunCount(ids[0]) + tofMisses, releases);
+    failed = 1;
+  }
+
+  return failed;
+}
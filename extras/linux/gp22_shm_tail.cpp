@@ -0,0 +1,65 @@
+// Follows a GP22ShmBus ring and prints the records as CSV, or just keeps
+// count with -q. Any number of these can run alongside each other.
+//
+// Build: g++ -O2 -std=c++11 -o gp22_shm_tail gp22_shm_tail.cpp -lrt
+// Usage: gp22_shm_tail [-q] [-a] /gp22   (-a starts from the oldest record)
+
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "GP22ShmBus.h"
+
+static volatile sig_atomic_t running = 1;
+static void stop(int) {
+  running = 0;
+}
+
+int main(int argc, char ** argv) {
+  bool quiet = false;
+  bool fromOldest = false;
+  const char * name = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0)
+      quiet = true;
+    else if (strcmp(argv[i], "-a") == 0)
+      fromOldest = true;
+    else
+      name = argv[i];
+  }
+  if (name == NULL) {
+    fprintf(stderr, "usage: %s [-q] [-a] <shm name>\n", argv[0]);
+    return 1;
+  }
+
+  GP22ShmReader reader;
+  if (!reader.open(name, fromOldest)) {
+    fprintf(stderr, "can't attach to %s\n", name);
+    return 1;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  unsigned long long records = 0;
+  GP22ShmRecord record;
+  if (!quiet)
+    printf("timestamp_ns,generation,result,status\n");
+
+  while (running) {
+    if (!reader.read(record)) {
+      // Nothing new, there is no wakeup mechanism so just nap briefly.
+      usleep(1000);
+      continue;
+    }
+    records++;
+    if (!quiet)
+      printf("%llu,%u,%d,0x%04x\n", (unsigned long long)record.timestampNs, record.configGeneration,
+             record.result, record.status);
+  }
+
+  fprintf(stderr, "records %llu, lost %llu\n", records, (unsigned long long)reader.getLostCount());
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Benchmarks the synthetic result generator (GP22Synth.h), and optionally
+// a downstream stage fed from it, in millions of samples per second.
+//
+// Build: g++ -O3 -march=native -I../.. -o gp22_synth_bench gp22_synth_bench.cpp ../../GP22Kalman.cpp
+// Usage: gp22_synth_bench [-k] [-t timeouts] [-n millions]
+//   -k  run every good sample through GP22Kalman as well
+//   -t  the timeout rate (0 - 1)
+//   -n  how many million samples (default 100)
+//
+// The generator should come out well ahead of anything it feeds, otherwise
+// the numbers for the stage are really the generator's.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "GP22Synth.h"
+#include "GP22Kalman.h"
+
+#define BLOCK 4096
+
+static double now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int main(int argc, char ** argv) {
+  bool kalman = false;
+  double millions = 100;
+  GP22SynthConfig config = gp22SynthDefaults();
+  config.jitter = 200;
+  config.drift = 0.001f;
+  config.stepSize = 50 << 8;
+  config.stepShift = 20;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-k") == 0)
+      kalman = true;
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+      config.timeoutRate = atof(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      millions = atof(argv[++i]);
+    else {
+      fprintf(stderr, "usage: %s [-k] [-t timeouts] [-n millions]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  GP22Synth synth(config);
+  GP22Kalman filter(10, 200 * 200);
+  static int32_t results[BLOCK];
+  static uint16_t statuses[BLOCK];
+
+  uint64_t total = (uint64_t)(millions * 1e6);
+  uint64_t timeouts = 0;
+  // Keeps the compiler from throwing the work away
+  int64_t check = 0;
+
+  double start = now();
+  for (uint64_t n = 0; n < total; n += BLOCK) {
+    size_t count = total - n < BLOCK ? total - n : BLOCK;
+    synth.generate(n, count, results, statuses);
+
+    for (size_t i = 0; i < count; i++) {
+      if (statuses[i] & 0x0600) {
+        timeouts++;
+        continue;
+      }
+      if (kalman)
+        filter.update(results[i]);
+      check += results[i];
+    }
+  }
+  double elapsed = now() - start;
+
+  printf("%llu samples in %.3f s: %.1f M samples/s, %llu timeouts (%.3f%%)\n",
+    (unsigned long long)total, elapsed, total / elapsed / 1e6,
+    (unsigned long long)timeouts, 100.0 * timeouts / total);
+  printf("mean result %.1f LSB", (double)check / (total - timeouts));
+  if (kalman)
+    printf(", final estimate %d", filter.getEstimate());
+  printf("\n");
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Receives GP22Telemetry frames on a PC and prints them as CSV, or just
+// keeps count with -q (for checking the link keeps up).
+//
+// Build: g++ -O2 -I../.. -o gp22_telemetry_recv gp22_telemetry_recv.cpp
+// Usage: gp22_telemetry_recv [-q] /dev/ttyACM0   (or - for stdin)
+//
+// Frames are decoded in place in the read buffer, only a partial frame at
+// the end of a read gets moved down to the front.
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "GP22TelemetryFormat.h"
+
+// Big reads keep the syscall count down at full USB speed
+#define READ_BUFFER 65536
+
+int main(int argc, char ** argv) {
+  bool quiet = false;
+  const char * path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-q") == 0)
+      quiet = true;
+    else
+      path = argv[i];
+  }
+  if (path == NULL) {
+    fprintf(stderr, "usage: %s [-q] <tty|->\n", argv[0]);
+    return 1;
+  }
+
+  int fd = 0;
+  if (strcmp(path, "-") != 0) {
+    fd = open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+      perror(path);
+      return 1;
+    }
+    // Raw mode, if it is a tty (the baud rate doesn't matter for USB CDC)
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+      cfmakeraw(&tio);
+      tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+
+  static uint8_t buffer[READ_BUFFER];
+  size_t filled = 0;
+  unsigned long long frames = 0, records = 0, bad = 0, dropped = 0, gaps = 0;
+  bool haveSequence = false;
+  uint16_t expected = 0;
+
+  if (!quiet)
+    printf("sequence,timestamp_us,result,status\n");
+
+  while (true) {
+    ssize_t got = read(fd, buffer + filled, sizeof(buffer) - filled);
+    if (got <= 0)
+      break;
+    filled += got;
+
+    size_t start = 0;
+    for (size_t i = start; i < filled; i++) {
+      if (buffer[i] != 0)
+        continue;
+
+      GP22TelemetryFrame frame;
+      if (i > start && gp22TelemetryDecode(buffer + start, i - start, frame)) {
+        frames++;
+        records += frame.count;
+        dropped += frame.dropped;
+        if (haveSequence && frame.sequence != expected)
+          gaps++;
+        haveSequence = true;
+        expected = frame.sequence + 1;
+
+        if (!quiet) {
+          for (uint8_t n = 0; n < frame.count; n++)
+            printf("%u,%u,%d,0x%04x\n", frame.sequence, frame.timestamp,
+                   gp22TelemetryResult(frame, n), gp22TelemetryStatus(frame, n));
+        }
+      } else if (i > start) {
+        bad++;
+      }
+      start = i + 1;
+    }
+
+    // Keep the partial frame for the next read. If a whole buffer has no
+    // delimiter in it, it's rubbish.
+    if (start == 0 && filled == sizeof(buffer)) {
+      bad++;
+      filled = 0;
+    } else {
+      memmove(buffer, buffer + start, filled - start);
+      filled -= start;
+    }
+  }
+
+  fprintf(stderr, "frames %llu, records %llu, bad frames %llu, sequence gaps %llu, dropped on target %llu\n",
+          frames, records, bad, gaps, dropped);
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Decodes a GP22Recorder dump (captured from the serial port to a file) and
+// prints one transaction per line: time since the first one, source chip,
+// the opcode by name, and the bytes sent and received.
+//
+// Build: g++ -O2 -I../.. -o gp22_trace_dump gp22_trace_dump.cpp
+// Usage: gp22_trace_dump dump.bin   (or - for stdin)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "GP22TraceFormat.h"
+
+static const char * opcodeName(uint8_t opcode, char * buffer) {
+  if (opcode >= 0x80 && opcode <= 0x86) {
+    sprintf(buffer, "write reg %u", opcode - 0x80);
+    return buffer;
+  }
+  if (opcode >= 0xB0 && opcode <= 0xB3) {
+    sprintf(buffer, "read result %u", opcode - 0xB0);
+    return buffer;
+  }
+  switch (opcode) {
+    case 0x50: return "power on reset";
+    case 0x70: return "init";
+    case 0x01: return "start tof";
+    case 0x05: return "start tof restart";
+    case 0x02: return "start temp";
+    case 0x06: return "start temp restart";
+    case 0x03: return "start cal resonator";
+    case 0x04: return "start cal tdc";
+    case 0xB4: return "read status";
+    case 0xB5: return "read reg 1";
+    case 0xB8: return "read pw1st";
+  }
+  sprintf(buffer, "opcode 0x%02X", opcode);
+  return buffer;
+}
+
+int main(int argc, char ** argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <dump|->\n", argv[0]);
+    return 1;
+  }
+
+  FILE * in = stdin;
+  if (strcmp(argv[1], "-") != 0) {
+    in = fopen(argv[1], "rb");
+    if (in == NULL) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  // Dumps are at most 64k records, so just read the whole thing
+  size_t size = 0, capacity = 65536;
+  uint8_t * data = (uint8_t *)malloc(capacity);
+  size_t got;
+  while ((got = fread(data + size, 1, capacity - size, in)) > 0) {
+    size += got;
+    if (size == capacity) {
+      capacity *= 2;
+      data = (uint8_t *)realloc(data, capacity);
+    }
+  }
+
+  GP22TraceHeader header;
+  if (!gp22TraceDecodeHeader(data, size, header)) {
+    fprintf(stderr, "not a valid trace dump (bad magic, version, length or CRC)\n");
+    return 1;
+  }
+
+  printf("# %u transactions, %u older ones lost, clock %u Hz\n", header.count, header.lost, header.clockHz);
+
+  GP22TraceRecord record;
+  uint32_t first = 0;
+  char name[32];
+  for (uint16_t n = 0; n < header.count; n++) {
+    gp22TraceDecodeRecord(data, n, record);
+    if (n == 0)
+      first = record.cycles;
+    // Differences are right across the counter wrapping around
+    uint32_t elapsed = record.cycles - first;
+
+    if (header.clockHz > 0)
+      printf("%12.3f us", elapsed * 1000000.0 / header.clockHz);
+    else
+      printf("%12u cyc", elapsed);
+    printf("  chip %u  %-16s", record.source, opcodeName(record.opcode, name));
+
+    if (record.length > 4)
+      record.length = 4;
+    if (record.length > 0) {
+      printf("  tx");
+      for (uint8_t i = 0; i < record.length; i++)
+        printf(" %02X", record.tx[i]);
+      printf("  rx");
+      for (uint8_t i = 0; i < record.length; i++)
+        printf(" %02X", record.rx[i]);
+    }
+    printf("\n");
+  }
+
+  free(data);
+  return 0;
+}
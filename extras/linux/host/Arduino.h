@@ -0,0 +1,62 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Just enough of the Arduino core to build the library on a PC, for the
+// benchmarks and tools in extras/linux. Put this directory first on the
+// include path (-Ihost). Needs C++17 (for the inline SPI object).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, on) ((on) ? bitSet(value, bit) : bitClear(value, bit))
+
+// The binary constants the library uses
+#define B00000001 1
+#define B00000111 7
+#define B00001000 8
+#define B00001111 15
+#define B00010000 16
+#define B00011111 31
+#define B00100000 32
+#define B00110000 48
+#define B00111000 56
+#define B00111111 63
+#define B01000000 64
+#define B10000000 128
+#define B11110000 240
+#define B11111000 248
+
+#define INPUT 0
+#define OUTPUT 1
+#define FALLING 2
+
+inline uint32_t micros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000000ULL + now.tv_nsec / 1000);
+}
+inline uint32_t millis() {
+  return micros() / 1000;
+}
+inline void delay(uint32_t ms) {
+  uint32_t start = millis();
+  while (millis() - start < ms) {}
+}
+
+inline void pinMode(int, int) {}
+inline int digitalPinToInterrupt(int pin) {
+  return pin;
+}
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+#include "Print.h"
+
+#endif
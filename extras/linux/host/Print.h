@@ -0,0 +1,59 @@
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// The Arduino Print class, for the host build. Subclasses provide
+// write(uint8_t), and can provide the buffer version for speed.
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t byte) = 0;
+  virtual size_t write(const uint8_t * buffer, size_t size) {
+    size_t written = 0;
+    while (size--)
+      written += write(*buffer++);
+    return written;
+  }
+
+  size_t print(const char * text) {
+    return write((const uint8_t *)text, strlen(text));
+  }
+  size_t print(unsigned long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%lu", value);
+    return print(text);
+  }
+  size_t print(long value) {
+    char text[24];
+    snprintf(text, sizeof(text), "%ld", value);
+    return print(text);
+  }
+  size_t print(double value, int digits = 2) {
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return print(text);
+  }
+};
+
+// Prints to a stdio stream
+class FilePrint : public Print
+{
+public:
+  FilePrint(FILE * file) : _file(file) {}
+  size_t write(uint8_t byte) {
+    return fputc(byte, _file) == EOF ? 0 : 1;
+  }
+  size_t write(const uint8_t * buffer, size_t size) {
+    return fwrite(buffer, 1, size, _file);
+  }
+
+private:
+  FILE * _file;
+};
+
+#endif
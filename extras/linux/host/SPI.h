@@ -0,0 +1,29 @@
+#ifndef SPI_h
+#define SPI_h
+
+#include "Arduino.h"
+
+#define SPI_CONTINUE 0
+#define SPI_LAST 1
+#define SPI_MODE1 1
+#define MSBFIRST 1
+
+// The Due's SPI API (with the chip select pin on every call), going nowhere.
+// Reads come back as 0, so there is never a result, but the CPU side of
+// every transfer is still done.
+class SPIClass
+{
+public:
+  void begin(uint8_t) {}
+  void end() {}
+  void setClockDivider(uint8_t, uint8_t) {}
+  void setDataMode(uint8_t, uint8_t) {}
+  void setBitOrder(uint8_t, int) {}
+  uint8_t transfer(uint8_t, uint8_t, int = SPI_LAST) {
+    return 0;
+  }
+};
+
+inline SPIClass SPI;
+
+#endif